@@ -0,0 +1,611 @@
+// Benchmarks for the recalculation paths, run with make bench
+#include "spreadsheet.h"
+#include "rangekernels.h"
+#include "depset.h"
+#include "vector.h"
+#include "orderedset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_ROWS 999
+#define BENCH_COLS 18278
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void assign(Spreadsheet *sheet, const char *cell_name, const char *formula) {
+    char status[64];
+    spreadsheet_set_cell_value(sheet, (char *)cell_name, formula, status, sizeof(status));
+}
+
+// Hundreds of overlapping SUM/AVG(A1:Y500) formulas on a full size grid: assigning them,
+// editing their inputs, and evaluating the same ranges as text
+static void bench_range_sums(int prefix_sums) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    if (prefix_sums && !spreadsheet_enable_prefix_sums(sheet)) {
+        printf("prefix sums could not be allocated\n");
+        destroySpreadsheet(sheet);
+        return;
+    }
+    srand(42);
+    for (int i = 0; i < 200000; i++)
+        spreadsheet_store_value(sheet, 1 + rand() % 500, 1 + rand() % 5000, rand() % 100, 0);
+
+    char cell_name[32], formula[64], col[16];
+    int formulas = 300;
+    double t0 = now_seconds();
+    for (int i = 0; i < formulas; i++) {
+        spreadsheet_col_to_letter(1000 + 13 * i, col, sizeof(col));
+        snprintf(formula, sizeof(formula), "%s(A1:%s500)", (i & 1) ? "AVG" : "SUM", col);
+        snprintf(cell_name, sizeof(cell_name), "A%d", 600 + i);
+        assign(sheet, cell_name, formula);
+    }
+    double t1 = now_seconds();
+    for (int i = 0; i < 2000; i++) {
+        spreadsheet_col_to_letter(1 + rand() % 1000, col, sizeof(col));
+        snprintf(cell_name, sizeof(cell_name), "%s%d", col, 1 + rand() % 500);
+        snprintf(formula, sizeof(formula), "%d", rand() % 100);
+        assign(sheet, cell_name, formula);
+    }
+    double t2 = now_seconds();
+    char error = 0;
+    long long checksum = 0;
+    for (int i = 0; i < formulas; i++) {
+        spreadsheet_col_to_letter(1000 + 13 * i, col, sizeof(col));
+        snprintf(formula, sizeof(formula), "SUM(A1:%s500)", col);
+        checksum += spreadsheet_evaluate_expression(sheet, formula, &error);
+    }
+    double t3 = now_seconds();
+
+    printf("%-12s assign %d ranges %8.3f s | 2000 input edits %8.3f s | %d text SUMs %8.3f s | checksum %lld\n",
+           prefix_sums ? "prefix sums" : "full scan", formulas, t1 - t0, t2 - t1, formulas, t3 - t2, checksum);
+    destroySpreadsheet(sheet);
+}
+
+// Text MAX over large ranges before and after the first MIN/MAX formula builds the tile tree,
+// then edits that keep moving the extremum of overlapping MIN/MAX formulas
+static void bench_range_extrema() {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    srand(42);
+    for (int i = 0; i < 200000; i++)
+        spreadsheet_store_value(sheet, 1 + rand() % 500, 1 + rand() % 5000, rand() % 100, 0);
+
+    char cell_name[32], formula[64], col[16];
+    char error = 0;
+    int formulas = 300;
+    long long checksum = 0;
+    double times[4];
+    for (int pass = 0; pass < 2; pass++) {
+        double t0 = now_seconds();
+        for (int i = 0; i < formulas; i++) {
+            spreadsheet_col_to_letter(1000 + 13 * i, col, sizeof(col));
+            snprintf(formula, sizeof(formula), "MAX(B2:%s499)", col);
+            checksum += spreadsheet_evaluate_expression(sheet, formula, &error);
+        }
+        times[pass] = now_seconds() - t0;
+        if (pass == 0)
+            assign(sheet, "A999", "MIN(A1:A2)");
+    }
+    double t0 = now_seconds();
+    for (int i = 0; i < formulas; i++) {
+        spreadsheet_col_to_letter(1000 + 13 * i, col, sizeof(col));
+        snprintf(formula, sizeof(formula), "%s(A1:%s500)", (i & 1) ? "MIN" : "MAX", col);
+        snprintf(cell_name, sizeof(cell_name), "A%d", 600 + i);
+        assign(sheet, cell_name, formula);
+    }
+    times[2] = now_seconds() - t0;
+    t0 = now_seconds();
+    for (int i = 0; i < 2000; i++) {
+        spreadsheet_col_to_letter(1 + rand() % 1000, col, sizeof(col));
+        snprintf(cell_name, sizeof(cell_name), "%s%d", col, 1 + rand() % 500);
+        snprintf(formula, sizeof(formula), "%d", (i & 1) ? -1 - i : 100 + i);
+        assign(sheet, cell_name, formula);
+    }
+    times[3] = now_seconds() - t0;
+
+    printf("%d text MAXs: full scan %8.3f s | tile tree %8.3f s\n", formulas, times[0], times[1]);
+    printf("assign %d MIN/MAX ranges %8.3f s | 2000 extremum edits %8.3f s | checksum %lld\n",
+           formulas, times[2], times[3], checksum);
+    destroySpreadsheet(sheet);
+}
+
+// Text SUM, STDEV and MIN over whole rows of a full size grid at every kernel level the CPU
+// supports, whole rows are one contiguous run of values
+static void bench_range_kernels() {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    srand(42);
+    for (int i = 0; i < 2000000; i++)
+        spreadsheet_store_value(sheet, 1 + rand() % BENCH_ROWS, 1 + rand() % BENCH_COLS, rand() % 100, 0);
+
+    const char *formulas[] = {"SUM(A1:ZZZ200)", "STDEV(A1:ZZZ200)", "MIN(A1:ZZZ200)", "SUM(B1:ZZY200)"};
+    KernelLevel best = kernels_select(KERNEL_AVX2);
+    for (int level = KERNEL_SCALAR; level <= (int)best; level++) {
+        kernels_select((KernelLevel)level);
+        char error = 0;
+        long long checksum = 0;
+        printf("%-8s", kernels_level_name((KernelLevel)level));
+        for (int f = 0; f < 4; f++) {
+            double t0 = now_seconds();
+            for (int i = 0; i < 20; i++)
+                checksum += spreadsheet_evaluate_expression(sheet, formulas[f], &error);
+            printf(" | 20x %-17s %7.3f s", formulas[f], now_seconds() - t0);
+        }
+        printf(" | checksum %lld\n", checksum);
+    }
+    kernels_select(best);
+    destroySpreadsheet(sheet);
+}
+
+// Recalculation ordering on a diamond lattice, where every cell reads the cells to its left
+// and above it, and on one long chain. Each edit of the first cell recalculates everything
+static void bench_recalc_order(int lattice, int chain) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    char name[32], left[32], up[32], formula[80];
+    assign(sheet, "A1", "1");
+    for (int r = 1; r <= lattice; r++) {
+        for (int c = 1; c <= lattice; c++) {
+            if (r == 1 && c == 1)
+                continue;
+            spreadsheet_get_cell_name(r, c, name, sizeof(name));
+            spreadsheet_get_cell_name(r, c - 1, left, sizeof(left));
+            spreadsheet_get_cell_name(r - 1, c, up, sizeof(up));
+            if (r == 1 || c == 1)
+                snprintf(formula, sizeof(formula), "%s+1", (r == 1) ? left : up);
+            else
+                snprintf(formula, sizeof(formula), "%s-%s", left, up);
+            assign(sheet, name, formula);
+        }
+    }
+    double t0 = now_seconds();
+    for (int i = 0; i < 10; i++) {
+        snprintf(formula, sizeof(formula), "%d", i);
+        assign(sheet, "A1", formula);
+    }
+    double t1 = now_seconds();
+
+    // The chain snakes down the columns starting at column 1000, so it does not touch the lattice
+    spreadsheet_get_cell_name(1, 1000, name, sizeof(name));
+    assign(sheet, name, "1");
+    for (int i = 1; i < chain; i++) {
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 1000 + i / BENCH_ROWS, name, sizeof(name));
+        spreadsheet_get_cell_name((i - 1) % BENCH_ROWS + 1, 1000 + (i - 1) / BENCH_ROWS, up, sizeof(up));
+        snprintf(formula, sizeof(formula), "%s+1", up);
+        assign(sheet, name, formula);
+    }
+    double t2 = now_seconds();
+    spreadsheet_get_cell_name(1, 1000, name, sizeof(name));
+    for (int i = 0; i < 10; i++) {
+        snprintf(formula, sizeof(formula), "%d", i);
+        assign(sheet, name, formula);
+    }
+    double t3 = now_seconds();
+    // Closing the chain into a loop walks all of it before the edit is rejected
+    spreadsheet_get_cell_name((chain - 1) % BENCH_ROWS + 1, 1000 + (chain - 1) / BENCH_ROWS, up, sizeof(up));
+    snprintf(formula, sizeof(formula), "%s+1", up);
+    for (int i = 0; i < 10; i++)
+        assign(sheet, name, formula);
+    double t4 = now_seconds();
+
+    printf("%dx%d lattice: 10 full recalcs %8.3f s | %d cell chain: 10 full recalcs %8.3f s, 10 rejected cycles %8.3f s\n",
+           lattice, lattice, t1 - t0, chain, t3 - t2, t4 - t3);
+    destroySpreadsheet(sheet);
+}
+
+// A MAX over an edited cell and a large constant feeds a rows x width grid. Edits below
+// the constant are absorbed by the MAX, edits above it reach every cell of the grid
+static void bench_change_pruning(int rows, int width) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    char name[32], up[32], formula[80];
+    assign(sheet, "A1", "0");
+    assign(sheet, "A2", "1000000");
+    assign(sheet, "B1", "MAX(A1:A2)");
+    for (int r = 3; r <= rows + 2; r++) {
+        for (int c = 3; c < width + 3; c++) {
+            spreadsheet_get_cell_name(r, c, name, sizeof(name));
+            spreadsheet_get_cell_name(r - 1, c, up, sizeof(up));
+            snprintf(formula, sizeof(formula), "%s+%d", r == 3 ? "B1" : up, c);
+            assign(sheet, name, formula);
+        }
+    }
+    for (int absorbed = 1; absorbed >= 0; absorbed--) {
+        sheet->stats = (RecalcStats){0, 0, 0};
+        double t0 = now_seconds();
+        for (int i = 0; i < 10; i++) {
+            snprintf(formula, sizeof(formula), "%d", absorbed ? i : 2000000 + i);
+            assign(sheet, "A1", formula);
+        }
+        double t1 = now_seconds();
+        printf("%dx%d grid, 10 %s edits: %8.3f s | evaluated %llu, unchanged %llu, skipped %llu\n",
+               rows, width, absorbed ? "absorbed" : "propagated", t1 - t0,
+               (unsigned long long)sheet->stats.evaluated, (unsigned long long)sheet->stats.unchanged,
+               (unsigned long long)sheet->stats.skipped);
+    }
+    destroySpreadsheet(sheet);
+}
+
+// A batch of edits to the corner of a lattice followed by one read of the far corner,
+// recalculated after every edit, once for the whole batch in manual mode, and in lazy mode
+static void bench_batch_edits(int lattice, int edits) {
+    const char *modes[] = {"eager ", "manual", "lazy  "};
+    for (int mode = 0; mode < 3; mode++) {
+        Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+        spreadsheet_set_lazy(sheet, mode == 2);
+        char name[32], left[32], up[32], formula[80];
+        assign(sheet, "A1", "1");
+        for (int r = 1; r <= lattice; r++) {
+            for (int c = 1; c <= lattice; c++) {
+                if (r == 1 && c == 1)
+                    continue;
+                spreadsheet_get_cell_name(r, c, name, sizeof(name));
+                spreadsheet_get_cell_name(r, c - 1, left, sizeof(left));
+                spreadsheet_get_cell_name(r - 1, c, up, sizeof(up));
+                if (r == 1 || c == 1)
+                    snprintf(formula, sizeof(formula), "%s+1", (r == 1) ? left : up);
+                else
+                    snprintf(formula, sizeof(formula), "%s-%s", left, up);
+                assign(sheet, name, formula);
+            }
+        }
+        spreadsheet_resolve(sheet, lattice, lattice);
+        sheet->stats = (RecalcStats){0, 0, 0};
+        double t0 = now_seconds();
+        spreadsheet_set_manual(sheet, mode == 1);
+        for (int i = 0; i < edits; i++) {
+            snprintf(formula, sizeof(formula), "%d", i);
+            assign(sheet, "A1", formula);
+        }
+        spreadsheet_set_manual(sheet, 0);
+        spreadsheet_resolve(sheet, lattice, lattice);
+        double t1 = now_seconds();
+        printf("%s: %dx%d lattice, %d edits and one read %8.3f s | evaluated %llu, far corner %d\n",
+               modes[mode], lattice, lattice, edits, t1 - t0,
+               (unsigned long long)sheet->stats.evaluated, spreadsheet_get_value(sheet, lattice, lattice));
+        destroySpreadsheet(sheet);
+    }
+}
+
+// A chain snaking down the columns, each cell reading the next one, assigned from its
+// head so every formula lands in front of everything already loaded. One by one that
+// re-ranks and recalculates the whole loaded chain per formula, a bulk load does it once
+static void bench_bulk_load(int chain, int sequential) {
+    char (*names)[16] = malloc(chain * sizeof(*names));
+    char (*texts)[24] = malloc(chain * sizeof(*texts));
+    BulkAssignment *items = malloc(chain * sizeof(BulkAssignment));
+    if (!names || !texts || !items) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < chain; i++) {
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, i / BENCH_ROWS + 1, names[i], sizeof(names[i]));
+        char next[16];
+        spreadsheet_get_cell_name((i + 1) % BENCH_ROWS + 1, (i + 1) / BENCH_ROWS + 1, next, sizeof(next));
+        if (i == chain - 1)
+            snprintf(texts[i], sizeof(texts[i]), "1");
+        else
+            snprintf(texts[i], sizeof(texts[i]), "%s+1", next);
+    }
+    for (int bulk = !sequential; bulk <= 1; bulk++) {
+        Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+        double t0 = now_seconds();
+        if (bulk) {
+            for (int i = 0; i < chain; i++) {
+                spreadsheet_parse_command(sheet, names[i], texts[i], &items[i].row, &items[i].col, &items[i].formula);
+            }
+            spreadsheet_assign_bulk(sheet, items, chain);
+        } else {
+            for (int i = 0; i < chain; i++)
+                assign(sheet, names[i], texts[i]);
+        }
+        double t1 = now_seconds();
+        printf("%s: %d formula chain %8.3f s | head %d\n", bulk ? "bulk      " : "one by one", chain, t1 - t0,
+               spreadsheet_get_value(sheet, 1, 1));
+        destroySpreadsheet(sheet);
+    }
+    free(names);
+    free(texts);
+    free(items);
+}
+
+// The dependents container cells used before DepSet: a Vector of up to 8 ids, then an
+// AVL OrderedSet for good
+typedef struct LegacyDeps {
+    int in_set;
+    Vector *vector;
+    OrderedSet *set;
+} LegacyDeps;
+
+static void legacy_insert(LegacyDeps *deps, uint32_t id) {
+    if (deps->in_set) {
+        orderedset_insert(deps->set, id);
+        return;
+    }
+    if (deps->vector == NULL) {
+        deps->vector = malloc(sizeof(Vector));
+        vector_init(deps->vector);
+    }
+    if (deps->vector->size > 7) {
+        deps->set = orderedset_create();
+        for (int i = 0; i < deps->vector->size; i++)
+            orderedset_insert(deps->set, deps->vector->data[i]);
+        orderedset_insert(deps->set, id);
+        vector_free(deps->vector);
+        free(deps->vector);
+        deps->in_set = 1;
+    } else {
+        vector_push_back(deps->vector, id);
+    }
+}
+
+static void legacy_foreach(LegacyDeps *deps, void (*func)(uint32_t, void *), void *ctx) {
+    if (deps->in_set) {
+        orderedset_foreach(deps->set, func, ctx);
+    } else if (deps->vector != NULL) {
+        for (int i = 0; i < deps->vector->size; i++)
+            func(deps->vector->data[i], ctx);
+    }
+}
+
+static void legacy_remove(LegacyDeps *deps, uint32_t id) {
+    if (deps->in_set)
+        orderedset_remove(deps->set, id);
+    else
+        vector_remove(deps->vector, id);
+}
+
+static void legacy_free(LegacyDeps *deps) {
+    if (deps->in_set) {
+        orderedset_destroy(deps->set);
+    } else if (deps->vector != NULL) {
+        vector_free(deps->vector);
+        free(deps->vector);
+    }
+}
+
+static void sum_id(uint32_t id, void *ctx) {
+    *(uint64_t *)ctx += id;
+}
+
+// Containers of the given fan-out filled, walked 8 times and emptied, about a million ids
+// in total per fan-out
+static void bench_dependents(void) {
+    int fanouts[] = {1, 3, 4, 8, 16, 64, 1024};
+    for (int f = 0; f < (int)(sizeof(fanouts) / sizeof(fanouts[0])); f++) {
+        int fanout = fanouts[f];
+        int sets = (1 << 20) / fanout;
+        double times[2];
+        uint64_t sums[2] = {0, 0};
+        for (int kind = 0; kind < 2; kind++) {
+            LegacyDeps *legacy = calloc(sets, sizeof(LegacyDeps));
+            DepSet *depsets = malloc(sets * sizeof(DepSet));
+            if (!legacy || !depsets) {
+                perror("Failed to allocate memory");
+                exit(EXIT_FAILURE);
+            }
+            double t0 = now_seconds();
+            for (int s = 0; s < sets; s++) {
+                depset_init(&depsets[s]);
+                for (int i = 0; i < fanout; i++) {
+                    uint32_t id = (uint32_t)(s * 7919 + i * 104729) % 18258722;
+                    if (kind)
+                        depset_insert(&depsets[s], id);
+                    else
+                        legacy_insert(&legacy[s], id);
+                }
+            }
+            for (int pass = 0; pass < 8; pass++) {
+                for (int s = 0; s < sets; s++) {
+                    if (kind)
+                        depset_foreach(&depsets[s], sum_id, &sums[kind]);
+                    else
+                        legacy_foreach(&legacy[s], sum_id, &sums[kind]);
+                }
+            }
+            for (int s = 0; s < sets; s++) {
+                for (int i = fanout - 1; i >= 0; i--) {
+                    uint32_t id = (uint32_t)(s * 7919 + i * 104729) % 18258722;
+                    if (kind)
+                        depset_remove(&depsets[s], id);
+                    else
+                        legacy_remove(&legacy[s], id);
+                }
+                if (kind)
+                    depset_free(&depsets[s]);
+                else
+                    legacy_free(&legacy[s]);
+            }
+            times[kind] = now_seconds() - t0;
+            free(legacy);
+            free(depsets);
+        }
+        printf("fan-out %4d: Vector/OrderedSet %8.3f s | DepSet %8.3f s%s\n", fanout, times[0], times[1],
+               sums[0] == sums[1] ? "" : " (walks differ)");
+    }
+}
+
+// Head edits, closing the graph into a loop and the bare recalculation order, once read
+// from the cells' own sets and once from the frozen snapshot
+static void time_snapshot_walks(Spreadsheet *sheet, const char *head, const char *loop, const char *label) {
+    char formula[16];
+    double times[2][3];
+    for (int frozen = 0; frozen < 2; frozen++) {
+        if (frozen)
+            spreadsheet_freeze_dependents(sheet);
+        else
+            spreadsheet_thaw_dependents(sheet);
+        double t0 = now_seconds();
+        for (int i = 0; i < 10; i++) {
+            snprintf(formula, sizeof(formula), "%d", i);
+            assign(sheet, head, formula);
+        }
+        double t1 = now_seconds();
+        for (int i = 0; i < 10; i++)
+            assign(sheet, head, loop);
+        double t2 = now_seconds();
+        int row, col;
+        const uint32_t *order;
+        spreadsheet_parse_cell_name(sheet, head, &row, &col);
+        for (int i = 0; i < 10; i++)
+            spreadsheet_recalc_order(sheet, spreadsheet_get_cell(sheet, row, col), &order);
+        double t3 = now_seconds();
+        times[frozen][0] = t1 - t0;
+        times[frozen][1] = t2 - t1;
+        times[frozen][2] = t3 - t2;
+    }
+    printf("%s, 10 edits: cell sets %.3f s | snapshot %.3f s\n", label, times[0][0], times[1][0]);
+    printf("%s, 10 rejected loops: cell sets %.3f s | snapshot %.3f s\n", label, times[0][1], times[1][1]);
+    printf("%s, 10 orderings: cell sets %.3f s | snapshot %.3f s\n", label, times[0][2], times[1][2]);
+}
+
+// A chain snaking down the columns, and one cell read by fanout cells that each feed a
+// second cell, walked with and without the CSR snapshot
+static void bench_dependency_snapshot(int chain, int fanout) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    char name[32], up[32], formula[80];
+    assign(sheet, "A1", "1");
+    for (int i = 1; i < chain; i++) {
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 1 + i / BENCH_ROWS, name, sizeof(name));
+        spreadsheet_get_cell_name((i - 1) % BENCH_ROWS + 1, 1 + (i - 1) / BENCH_ROWS, up, sizeof(up));
+        snprintf(formula, sizeof(formula), "%s+1", up);
+        assign(sheet, name, formula);
+    }
+    spreadsheet_get_cell_name((chain - 1) % BENCH_ROWS + 1, 1 + (chain - 1) / BENCH_ROWS, up, sizeof(up));
+    snprintf(formula, sizeof(formula), "%s+1", up);
+    snprintf(name, sizeof(name), "deep chain of %d", chain);
+    time_snapshot_walks(sheet, "A1", formula, name);
+    destroySpreadsheet(sheet);
+
+    sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    assign(sheet, "A1", "1");
+    for (int i = 0; i < fanout; i++) {
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 2 + 2 * (i / BENCH_ROWS), name, sizeof(name));
+        assign(sheet, name, "A1+1");
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 3 + 2 * (i / BENCH_ROWS), up, sizeof(up));
+        snprintf(formula, sizeof(formula), "%s*2", name);
+        assign(sheet, up, formula);
+    }
+    snprintf(formula, sizeof(formula), "%s+1", up);
+    snprintf(name, sizeof(name), "fan-out of %d", fanout);
+    time_snapshot_walks(sheet, "A1", formula, name);
+    destroySpreadsheet(sheet);
+}
+
+// Materialising cells, swapping formulas between a point and a range form so that texts,
+// aggregates and range index nodes are released and taken again, and tearing it all down
+static void bench_allocation(int cells, int churn) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    char name[32];
+    double t0 = now_seconds();
+    for (int i = 0; i < cells; i++) {
+        spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 2 + i / BENCH_ROWS, name, sizeof(name));
+        assign(sheet, name, "7");
+    }
+    double t1 = now_seconds();
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < churn; i++) {
+            spreadsheet_get_cell_name(i % BENCH_ROWS + 1, 2 + i / BENCH_ROWS, name, sizeof(name));
+            assign(sheet, name, round % 2 ? "A1+1" : "MAX(A1:A2)");
+        }
+    }
+    double t2 = now_seconds();
+    destroySpreadsheet(sheet);
+    double t3 = now_seconds();
+    printf("%d cells materialised %8.3f s | %d formulas swapped 4 times %8.3f s | destroy %8.3f s\n",
+           cells, t1 - t0, churn, t2 - t1, t3 - t2);
+}
+
+// Columns filled down with one formula each, alternating a sliding MAX window over the
+// column to the left and a sum of that column and column A: two shapes for every cell
+static void bench_formula_templates(int width) {
+    Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+    char name[32], first[32], last[32], formula[80];
+    double t0 = now_seconds();
+    for (int c = 2; c <= width + 1; c++) {
+        for (int r = 1; r <= BENCH_ROWS; r++) {
+            spreadsheet_get_cell_name(r, c, name, sizeof(name));
+            spreadsheet_get_cell_name(r, c - 1, first, sizeof(first));
+            if (c & 1) {
+                snprintf(formula, sizeof(formula), "%s+A%d", first, r);
+            } else {
+                spreadsheet_get_cell_name(r + 9 <= BENCH_ROWS ? r + 9 : BENCH_ROWS, c - 1, last, sizeof(last));
+                snprintf(formula, sizeof(formula), "MAX(%s:%s)", first, last);
+            }
+            assign(sheet, name, formula);
+        }
+    }
+    double t1 = now_seconds();
+    for (int i = 0; i < 5; i++) {
+        snprintf(formula, sizeof(formula), "%d", i * 3);
+        assign(sheet, "A500", formula);
+    }
+    double t2 = now_seconds();
+    size_t cells = sheet->cell_pool.live;
+    size_t bytes = cells * sheet->cell_pool.object_size + sheet->templates->capacity * sizeof(FormulaTemplate);
+    printf("%zu cells, %u templates: load %8.3f s | 5 edits %8.3f s | %.1f bytes per cell\n",
+           cells, sheet->templates->live, t1 - t0, t2 - t1, (double)bytes / cells);
+    destroySpreadsheet(sheet);
+}
+
+// Rows of STDEV/MAX formulas each reading a window of the row above, so every row is one
+// wide rank level, recalculated from the top on 1..8 threads
+static void bench_parallel_recalc(int rows, int width) {
+    char name[32], first[32], last[32], formula[80];
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        Spreadsheet *sheet = spreadsheet_create(BENCH_ROWS, BENCH_COLS);
+        spreadsheet_set_threads(sheet, threads);
+        assign(sheet, "A1", "1");
+        for (int r = 2; r <= rows; r++) {
+            for (int c = 1; c <= width; c++) {
+                spreadsheet_get_cell_name(r, c, name, sizeof(name));
+                spreadsheet_get_cell_name(r - 1, c, first, sizeof(first));
+                spreadsheet_get_cell_name(r - 1, c + 31 < width ? c + 31 : width, last, sizeof(last));
+                if (r == 2)
+                    snprintf(formula, sizeof(formula), "A1*%d", c % 97);
+                else
+                    snprintf(formula, sizeof(formula), "%s(%s:%s)", (c & 1) ? "STDEV" : "MAX", first, last);
+                assign(sheet, name, formula);
+            }
+        }
+        double t0 = now_seconds();
+        for (int i = 0; i < 5; i++) {
+            snprintf(formula, sizeof(formula), "%d", i * 7 - 30);
+            assign(sheet, "A1", formula);
+        }
+        double t1 = now_seconds();
+        printf("%d threads: %dx%d fan-out, 5 full recalcs %8.3f s\n", threads, rows, width, t1 - t0);
+        destroySpreadsheet(sheet);
+    }
+}
+
+int main() {
+    printf("=== Range sum benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_range_sums(0);
+    bench_range_sums(1);
+    printf("=== Range MIN/MAX benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_range_extrema();
+    printf("=== Range kernel benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_range_kernels();
+    printf("=== Recalculation order benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_recalc_order(300, 200000);
+    printf("=== Change-driven recalculation benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_change_pruning(100, 1000);
+    printf("=== Batch edit benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_batch_edits(200, 100);
+    printf("=== Bulk load benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_bulk_load(5000, 1);
+    bench_bulk_load(100000, 0);
+    printf("=== Dependents container benchmark ===\n");
+    bench_dependents();
+    printf("=== Dependency snapshot benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_dependency_snapshot(200000, 100000);
+    printf("=== Allocation benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_allocation(1000000, 100000);
+    printf("=== Formula template benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_formula_templates(200);
+    printf("=== Parallel recalculation benchmark (%dx%d) ===\n", BENCH_ROWS, BENCH_COLS);
+    bench_parallel_recalc(60, 1000);
+    return 0;
+}
@@ -2,36 +2,50 @@
 #ifndef CELL_H
 #define CELL_H
 
-#include "orderedset.h"
 #include <stdint.h>
-#include "vector.h"
+#include "depset.h"
+#include "templatetable.h"
 
 
+// Running state of a range formula, updated by the delta of every store into its range
+typedef struct RangeAggregate {
+    int64_t sum;            // SUM, AVG and STDEV only
+    __int128 sum_squares;   // STDEV only
+    int32_t extremum;       // current MIN or MAX of the range
+    int32_t extremum_count; // cells holding the extremum, 0 once it has to be rescanned
+    int32_t error_count;    // cells of the range in error
+} RangeAggregate;
+
+#define CELL_NOT_FROZEN UINT32_MAX
+
+// Formula and dependency record of a cell, values and error flags live in the sheet
 typedef struct Cell {
     int16_t row;
     int16_t col;
-    char error;
-    char container;
-    char dependents_initialised;
-    int value;
-    char *formula;
-    union Dependents{
-        OrderedSet *dependents_set;
-        Vector *dependents_vector;
-    } dependents;
+    uint32_t frozen;            // node of the dependents in the sheet's snapshot, CELL_NOT_FROZEN if read from the set
+    uint32_t shape;             // formula as an interned template of the sheet, relative to this cell
+    RangeAggregate *aggregate;  // only set for range formulas
+    DepSet dependents;          // ids of the cells whose formula reads this one by reference
 } Cell;
 
 
 // Function to create a cell
 Cell* cell_create(int row, int col);
 
+void cell_init(Cell *cell, int row, int col);
+
 
 
 // Function to destroy a cell
 void cell_destroy(Cell *cell);
 
-void cell_dep_insert(Cell *cell, const char *key);
+// Dependents are stored as cell ids
+void cell_dep_insert(Cell *cell, uint32_t id);
+
+void cell_dep_remove(Cell *cell, uint32_t id);
+
+int cell_dep_contains(const Cell *cell, uint32_t id);
 
-void cell_dep_remove(Cell *cell, const char *key);
+void cell_dep_foreach(const Cell *cell, void (*func)(uint32_t, void*), void *ctx);
 
 #endif // CELL_H
\ No newline at end of file
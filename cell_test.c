@@ -1,47 +1,37 @@
 #include "cell.h"
-#include "orderedset.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+// Dependents are cell ids, these are the ids of a few cells in a 100 column sheet
+#define ID_A1 0u
+#define ID_B1 1u
+#define ID_C2 102u
+#define ID_D3 203u
+#define ID_E4 304u
+#define ID_X10 923u
+
 // Function to print a key
-void print_key(const char *key) {
-    printf("%s ", key);
+void print_key(uint32_t key) {
+    printf("%u ", key);
 }
 
 // Helper function to count elements during traversal
 int dependent_count = 0;
-void count_dependent(const char *key) {
+void count_dependent(uint32_t key, void *ctx) {
+    (void)ctx;
     dependent_count++;
     print_key(key);
 }
 
 // Helper function to safely add a dependent
-void add_dependent(Cell *cell, const char *dependent_key) {
+void add_dependent(Cell *cell, uint32_t dependent_key) {
     cell_dep_insert(cell,dependent_key);
 }
 
-char vector_contains(Vector *vec, const char *str) {
-    for (int16_t i = 0; i < vec->size; i++) {
-        if (strcmp(vec->data[i], str) == 0) {
-            return 1; // String found
-        }
-    }
-    return 0; // String not found
-}
-
-char cell_contains(Cell*cell,char *key){
-    if (cell->dependents_initialised==0){
-        return 0;
-    }
-    else if (cell->container==0){
-       Vector* vec = cell->dependents.dependents_vector;
-       return vector_contains(vec,key);
-    }
-    else {
-        return orderedset_contains(cell->dependents.dependents_set,key);
-    }
+char cell_contains(Cell*cell,uint32_t key){
+    return cell_dep_contains(cell, key);
 }
 
 int main() {
@@ -52,61 +42,80 @@ int main() {
     assert(cell != NULL);
     assert(cell->row == 1);
     assert(cell->col == 1);
-    assert(cell->value == 0);
-    assert(cell->error == 0);
-    assert(cell->formula == NULL);
-    assert(cell->dependents_initialised ==0);
+    assert(cell->shape == TEMPLATE_NONE);
+    assert(cell->dependents.size == 0 && cell->dependents.capacity == 0);
     printf("Cell created at position (%d,%d) - PASS\n\n", cell->row, cell->col);
     
-    printf("Test 2: Cell value modification\n");
-    cell->value = 100;
-    assert(cell->value == 100);
-    printf("Cell value set to %d - PASS\n\n", cell->value);
+    printf("Test 2: Cell formula assignment\n");
+    // The cell holds only the id of its formula's template, the sheet owns the table
+    cell->shape = 7;
+    assert(cell->shape == 7);
+    printf("Cell formula set to template %u - PASS\n\n", cell->shape);
     
-    printf("Test 3: Cell formula assignment\n");
-    char *formula = "=B1+C2";
-    cell->formula = malloc(strlen(formula)+1);
-    strcpy(cell->formula, formula);
-    assert(cell->formula != NULL);
-    assert(strcmp(cell->formula, "=B1+C2") == 0);
-    printf("Cell formula set to \"%s\" - PASS\n\n", cell->formula);
+    printf("Test 3: Managing dependents\n");
+    add_dependent(cell, ID_B1);
+    add_dependent(cell, ID_C2);
+    add_dependent(cell, ID_D3);
     
-    printf("Test 4: Error flag\n");
-    cell->error = 1;
-    assert(cell->error == 1);
-    printf("Cell error flag set - PASS\n\n");
-    
-    printf("Test 5: Managing dependents\n");
-    add_dependent(cell, "B1");
-    add_dependent(cell, "C2");
-    add_dependent(cell, "D3");
-    
-    assert(cell_contains(cell, "B1") == 1);
-    assert(cell_contains(cell, "C2") == 1);
-    assert(cell_contains(cell, "D3") == 1);
-    assert(cell_contains(cell, "E4") == 0);
+    assert(cell_contains(cell, ID_B1) == 1);
+    assert(cell_contains(cell, ID_C2) == 1);
+    assert(cell_contains(cell, ID_D3) == 1);
+    assert(cell_contains(cell, ID_E4) == 0);
     
 
-    printf("Test 6: Removing dependents\n");
-    cell_dep_remove(cell, "C2");
-    assert(cell_contains(cell, "C2") == 0);
+    printf("Test 4: Removing dependents\n");
+    cell_dep_remove(cell, ID_C2);
+    assert(cell_contains(cell, ID_C2) == 0);
     
-    printf("Test 7: Creating multiple cells\n");
+    dependent_count = 0;
+    printf("Remaining dependents: ");
+    cell_dep_foreach(cell, count_dependent, NULL);
+    printf("\n");
+    assert(dependent_count == 2);
+    printf("Dependents visited without copying - PASS\n\n");
+    
+    printf("Test 5: Creating multiple cells\n");
     Cell *cell2 = cell_create(2, 3);
     assert(cell2 != NULL);
     printf("Cell 2 created at position (%d,%d)\n", cell2->row, cell2->col);
     assert(cell2->row == 2 && cell2->col == 3);
     
-    add_dependent(cell2, "A1");
-    add_dependent(cell2, "X10");
+    add_dependent(cell2, ID_A1);
+    add_dependent(cell2, ID_X10);
     
     // Verify each cell has its own dependencies
-    assert(cell_contains(cell, "B1") == 1);
-    assert(cell_contains(cell2, "B1") == 0);
-    assert(cell_contains(cell, "A1") == 0);
-    assert(cell_contains(cell2, "A1") == 1);
+    assert(cell_contains(cell, ID_B1) == 1);
+    assert(cell_contains(cell2, ID_B1) == 0);
+    assert(cell_contains(cell, ID_A1) == 0);
+    assert(cell_contains(cell2, ID_A1) == 1);
     printf("Each cell maintains its own dependencies - PASS\n\n");
     
+    printf("Test 6: Growing past the inline ids into the hash set\n");
+    add_dependent(cell2, ID_A1);
+    assert(cell2->dependents.size == 2);
+    for (uint32_t id = 1000; id < 1020; id++) {
+        add_dependent(cell2, id);
+    }
+    assert(cell2->dependents.capacity > 0);
+    assert(cell_contains(cell2, ID_A1) == 1);
+    assert(cell_contains(cell2, 1019u) == 1);
+    cell_dep_remove(cell2, 1019u);
+    assert(cell_contains(cell2, 1019u) == 0);
+    dependent_count = 0;
+    cell_dep_foreach(cell2, count_dependent, NULL);
+    printf("\n");
+    assert(dependent_count == 21);
+    printf("Hash set holds all dependents - PASS\n\n");
+
+    printf("Test 7: Shrinking back inline\n");
+    for (uint32_t id = 1000; id < 1019; id++) {
+        cell_dep_remove(cell2, id);
+    }
+    cell_dep_remove(cell2, 1019u);
+    assert(cell2->dependents.size == 2 && cell2->dependents.capacity == 0);
+    assert(cell_contains(cell2, ID_A1) == 1 && cell_contains(cell2, ID_X10) == 1);
+    printf("Back to inline ids with %u dependents - PASS\n\n", cell2->dependents.size);
+    
     printf("Test 8: Memory management\n");
     size_t cell_size = sizeof(Cell);
     printf("Size of Cell struct: %zu bytes\n", cell_size);
@@ -0,0 +1,89 @@
+// csrgraph.c
+#include "csrgraph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void *grow(void *buffer, uint32_t *capacity, uint32_t needed, size_t size) {
+    if (needed <= *capacity)
+        return buffer;
+    uint32_t grown = *capacity ? *capacity : 64;
+    while (grown < needed)
+        grown *= 2;
+    buffer = realloc(buffer, grown * size);
+    if (!buffer) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = grown;
+    return buffer;
+}
+
+CsrGraph* csrgraph_create() {
+    CsrGraph *graph = calloc(1, sizeof(CsrGraph));
+    if (!graph) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    graph->offsets = grow(NULL, &graph->node_capacity, 1, sizeof(uint32_t));
+    graph->sources = malloc(graph->node_capacity * sizeof(uint32_t));
+    if (!graph->sources) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    graph->offsets[0] = 0;
+    return graph;
+}
+
+void csrgraph_clear(CsrGraph *graph) {
+    graph->node_count = 0;
+    graph->edge_count = 0;
+    graph->offsets[0] = 0;
+}
+
+uint32_t csrgraph_add_node(CsrGraph *graph, uint32_t source) {
+    // offsets and sources share node_capacity, offsets needs the extra end entry
+    if (graph->node_count + 2 > graph->node_capacity) {
+        uint32_t capacity = graph->node_capacity;
+        graph->offsets = grow(graph->offsets, &capacity, graph->node_count + 2, sizeof(uint32_t));
+        graph->sources = realloc(graph->sources, capacity * sizeof(uint32_t));
+        if (!graph->sources) {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
+        }
+        graph->node_capacity = capacity;
+    }
+    graph->sources[graph->node_count] = source;
+    graph->offsets[++graph->node_count] = graph->edge_count;
+    return graph->node_count - 1;
+}
+
+void csrgraph_add_edge(CsrGraph *graph, uint32_t target) {
+    graph->targets = grow(graph->targets, &graph->edge_capacity, graph->edge_count + 1, sizeof(uint32_t));
+    graph->targets[graph->edge_count++] = target;
+    graph->offsets[graph->node_count] = graph->edge_count;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void csrgraph_sort_edges(CsrGraph *graph) {
+    for (uint32_t node = 0; node < graph->node_count; node++) {
+        uint32_t begin = graph->offsets[node];
+        uint32_t count = graph->offsets[node + 1] - begin;
+        if (count > 1)
+            qsort(graph->targets + begin, count, sizeof(uint32_t), compare_ids);
+    }
+}
+
+void csrgraph_destroy(CsrGraph *graph) {
+    if (graph == NULL)
+        return;
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->sources);
+    free(graph);
+}
@@ -0,0 +1,37 @@
+// csrgraph.h
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <stdint.h>
+
+// Frozen adjacency lists in compressed sparse row form: the edges of every node sit
+// back to back in one targets array, so walking a node is a scan of contiguous ids
+// instead of a pointer chase. Nodes are appended one at a time with their edges and
+// never change afterwards, csrgraph_clear starts a new snapshot in the same buffers.
+typedef struct CsrGraph {
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t *offsets;      // node_count + 1 entries, node n owns targets[offsets[n] .. offsets[n + 1])
+    uint32_t *targets;
+    uint32_t *sources;      // key the caller gave each node
+    uint32_t node_capacity;
+    uint32_t edge_capacity;
+} CsrGraph;
+
+CsrGraph* csrgraph_create();
+void csrgraph_clear(CsrGraph *graph);
+// Starts a new node, the edges added after it belong to it. Returns its index
+uint32_t csrgraph_add_node(CsrGraph *graph, uint32_t source);
+void csrgraph_add_edge(CsrGraph *graph, uint32_t target);
+// Sorts the targets of every node, ascending
+void csrgraph_sort_edges(CsrGraph *graph);
+void csrgraph_destroy(CsrGraph *graph);
+
+static inline void csrgraph_foreach(const CsrGraph *graph, uint32_t node, void (*func)(uint32_t, void*), void *ctx) {
+    const uint32_t *target = graph->targets + graph->offsets[node];
+    const uint32_t *end = graph->targets + graph->offsets[node + 1];
+    for (; target < end; target++)
+        func(*target, ctx);
+}
+
+#endif // CSRGRAPH_H
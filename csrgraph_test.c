@@ -0,0 +1,77 @@
+#include "csrgraph.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define NODES 3000
+
+uint32_t seen[64];
+int seen_count;
+
+void collect(uint32_t id, void *ctx) {
+    (void)ctx;
+    assert(seen_count < 64);
+    seen[seen_count++] = id;
+}
+
+void collect_node(const CsrGraph *graph, uint32_t node) {
+    seen_count = 0;
+    csrgraph_foreach(graph, node, collect, NULL);
+}
+
+int main() {
+    printf("=== CsrGraph Test Suite ===\n\n");
+
+    printf("Test 1: Nodes keep their edges in order\n");
+    CsrGraph *graph = csrgraph_create();
+    assert(csrgraph_add_node(graph, 40) == 0);
+    csrgraph_add_edge(graph, 7);
+    csrgraph_add_edge(graph, 3);
+    assert(csrgraph_add_node(graph, 41) == 1);
+    assert(csrgraph_add_node(graph, 42) == 2);
+    csrgraph_add_edge(graph, 9);
+    assert(graph->node_count == 3 && graph->edge_count == 3);
+    collect_node(graph, 0);
+    assert(seen_count == 2 && seen[0] == 7 && seen[1] == 3);
+    collect_node(graph, 1);
+    assert(seen_count == 0);
+    collect_node(graph, 2);
+    assert(seen_count == 1 && seen[0] == 9);
+    assert(graph->sources[0] == 40 && graph->sources[2] == 42);
+    printf("Empty nodes and sources - PASS\n\n");
+
+    printf("Test 2: Sorting edges stays within each node\n");
+    csrgraph_sort_edges(graph);
+    collect_node(graph, 0);
+    assert(seen_count == 2 && seen[0] == 3 && seen[1] == 7);
+    collect_node(graph, 2);
+    assert(seen_count == 1 && seen[0] == 9);
+    printf("Targets ascending per node - PASS\n\n");
+
+    printf("Test 3: Clearing and growing past the first buffers\n");
+    csrgraph_clear(graph);
+    assert(graph->node_count == 0 && graph->edge_count == 0);
+    srand(3);
+    int degree[NODES];
+    for (uint32_t node = 0; node < NODES; node++) {
+        degree[node] = rand() % 40;
+        assert(csrgraph_add_node(graph, node * 5) == node);
+        for (int k = 0; k < degree[node]; k++)
+            csrgraph_add_edge(graph, (node * 31 + k * 7) % 1000);
+    }
+    csrgraph_sort_edges(graph);
+    uint32_t edges = 0;
+    for (uint32_t node = 0; node < NODES; node++) {
+        collect_node(graph, node);
+        assert(seen_count == degree[node] && graph->sources[node] == node * 5);
+        for (int k = 1; k < seen_count; k++)
+            assert(seen[k - 1] <= seen[k]);
+        edges += seen_count;
+    }
+    assert(edges == graph->edge_count);
+    csrgraph_destroy(graph);
+    printf("%u edges over %d nodes - PASS\n\n", edges, NODES);
+
+    printf("All csrgraph tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+// depset.c
+#include "depset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Smallest table, the load is kept between 1/8 and 1/2 of the slots
+#define DEPSET_MIN_SLOTS 16
+
+// Fibonacci hashing, the top bits of the product pick the slot
+static inline uint32_t slot_of(uint32_t id, uint32_t capacity) {
+    return (uint32_t)(id * 2654435769u) >> (32 - __builtin_ctz(capacity));
+}
+
+static uint32_t* table_alloc(uint32_t capacity) {
+    uint32_t *slots = malloc(capacity * sizeof(uint32_t));
+    if (!slots) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+    return slots;
+}
+
+// Returns 1 if id was added, 0 if it was already there
+static int table_insert(uint32_t *slots, uint32_t capacity, uint32_t id) {
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = slot_of(id, capacity);; i = (i + 1) & mask) {
+        if (slots[i] == id)
+            return 0;
+        if (slots[i] == DEPSET_EMPTY) {
+            slots[i] = id;
+            return 1;
+        }
+    }
+}
+
+static void table_resize(DepSet *set, uint32_t capacity) {
+    uint32_t *slots = table_alloc(capacity);
+    for (uint32_t i = 0; i < set->capacity; i++) {
+        if (set->u.slots[i] != DEPSET_EMPTY)
+            table_insert(slots, capacity, set->u.slots[i]);
+    }
+    free(set->u.slots);
+    set->u.slots = slots;
+    set->capacity = capacity;
+}
+
+void depset_init(DepSet *set) {
+    set->size = 0;
+    set->capacity = 0;
+}
+
+int depset_insert(DepSet *set, uint32_t id) {
+    if (set->capacity == 0) {
+        for (uint32_t i = 0; i < set->size; i++) {
+            if (set->u.ids[i] == id)
+                return 0;
+        }
+        if (set->size < DEPSET_INLINE) {
+            set->u.ids[set->size++] = id;
+            return 1;
+        }
+        // Spill the inline ids into a table
+        uint32_t ids[DEPSET_INLINE];
+        memcpy(ids, set->u.ids, sizeof(ids));
+        set->u.slots = table_alloc(DEPSET_MIN_SLOTS);
+        set->capacity = DEPSET_MIN_SLOTS;
+        for (int i = 0; i < DEPSET_INLINE; i++)
+            table_insert(set->u.slots, set->capacity, ids[i]);
+    }
+    if (!table_insert(set->u.slots, set->capacity, id))
+        return 0;
+    set->size++;
+    if (set->size * 2 > set->capacity)
+        table_resize(set, set->capacity * 2);
+    return 1;
+}
+
+int depset_remove(DepSet *set, uint32_t id) {
+    if (set->capacity == 0) {
+        for (uint32_t i = 0; i < set->size; i++) {
+            if (set->u.ids[i] == id) {
+                set->u.ids[i] = set->u.ids[--set->size];
+                return 1;
+            }
+        }
+        return 0;
+    }
+    uint32_t mask = set->capacity - 1;
+    uint32_t *slots = set->u.slots;
+    uint32_t i = slot_of(id, set->capacity);
+    while (slots[i] != id) {
+        if (slots[i] == DEPSET_EMPTY)
+            return 0;
+        i = (i + 1) & mask;
+    }
+    // Backward shift: pull later entries of the probe run into the hole unless their
+    // home slot lies after it, so lookups never need tombstones
+    slots[i] = DEPSET_EMPTY;
+    for (uint32_t j = (i + 1) & mask; slots[j] != DEPSET_EMPTY; j = (j + 1) & mask) {
+        uint32_t home = slot_of(slots[j], set->capacity);
+        int stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays)
+            continue;
+        slots[i] = slots[j];
+        slots[j] = DEPSET_EMPTY;
+        i = j;
+    }
+    set->size--;
+
+    if (set->size <= DEPSET_INLINE / 2) {
+        // Back inline, the table is not worth keeping for a couple of ids
+        uint32_t ids[DEPSET_INLINE];
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < set->capacity; k++) {
+            if (slots[k] != DEPSET_EMPTY)
+                ids[count++] = slots[k];
+        }
+        free(slots);
+        set->capacity = 0;
+        memcpy(set->u.ids, ids, count * sizeof(uint32_t));
+    } else if (set->capacity > DEPSET_MIN_SLOTS && set->size * 8 < set->capacity) {
+        table_resize(set, set->capacity / 2);
+    }
+    return 1;
+}
+
+int depset_contains(const DepSet *set, uint32_t id) {
+    if (set->capacity == 0) {
+        for (uint32_t i = 0; i < set->size; i++) {
+            if (set->u.ids[i] == id)
+                return 1;
+        }
+        return 0;
+    }
+    uint32_t mask = set->capacity - 1;
+    for (uint32_t i = slot_of(id, set->capacity); set->u.slots[i] != DEPSET_EMPTY; i = (i + 1) & mask) {
+        if (set->u.slots[i] == id)
+            return 1;
+    }
+    return 0;
+}
+
+// Calls func on every id, in no particular order
+void depset_foreach(const DepSet *set, void (*func)(uint32_t, void*), void *ctx) {
+    if (set->capacity == 0) {
+        for (uint32_t i = 0; i < set->size; i++)
+            func(set->u.ids[i], ctx);
+        return;
+    }
+    for (uint32_t i = 0; i < set->capacity; i++) {
+        if (set->u.slots[i] != DEPSET_EMPTY)
+            func(set->u.slots[i], ctx);
+    }
+}
+
+void depset_free(DepSet *set) {
+    if (set->capacity != 0)
+        free(set->u.slots);
+    depset_init(set);
+}
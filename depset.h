@@ -0,0 +1,33 @@
+// depset.h
+#ifndef DEPSET_H
+#define DEPSET_H
+
+#include <stdint.h>
+
+// Ids held in the set itself before it spills into a hash table
+#define DEPSET_INLINE 4
+
+// Set of dependent cell ids. Most cells have a handful of dependents, those are kept
+// inline with no allocation. Past DEPSET_INLINE the ids move to an open-addressing
+// hash table with linear probing, which moves back inline once the set is down to
+// DEPSET_INLINE / 2 so a set hovering at the limit does not keep reallocating.
+typedef struct DepSet {
+    uint32_t size;          // ids in the set
+    uint32_t capacity;      // slots of the table, 0 while the ids are inline
+    union {
+        uint32_t ids[DEPSET_INLINE];
+        uint32_t *slots;    // DEPSET_EMPTY marks a free slot
+    } u;
+} DepSet;
+
+#define DEPSET_EMPTY UINT32_MAX
+
+void depset_init(DepSet *set);
+// Both return 1 if the set changed, inserting a present id or removing a missing one is a no-op
+int depset_insert(DepSet *set, uint32_t id);
+int depset_remove(DepSet *set, uint32_t id);
+int depset_contains(const DepSet *set, uint32_t id);
+void depset_foreach(const DepSet *set, void (*func)(uint32_t, void*), void *ctx);
+void depset_free(DepSet *set);
+
+#endif // DEPSET_H
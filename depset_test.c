@@ -0,0 +1,89 @@
+#include "depset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define UNIVERSE 4096
+
+char present[UNIVERSE];
+int visited;
+
+void count_visit(uint32_t id, void *ctx) {
+    (void)ctx;
+    assert(id < UNIVERSE && present[id]);
+    visited++;
+}
+
+// Checks the set against the reference flags
+void check_set(DepSet *set) {
+    uint32_t size = 0;
+    for (uint32_t id = 0; id < UNIVERSE; id++) {
+        assert(depset_contains(set, id) == present[id]);
+        size += present[id];
+    }
+    assert(set->size == size);
+    visited = 0;
+    depset_foreach(set, count_visit, NULL);
+    assert((uint32_t)visited == size);
+}
+
+int main() {
+    printf("=== DepSet Test Suite ===\n\n");
+
+    printf("Test 1: Inline ids\n");
+    DepSet set;
+    depset_init(&set);
+    assert(depset_insert(&set, 7) == 1);
+    assert(depset_insert(&set, 7) == 0);
+    assert(depset_insert(&set, 0) == 1);
+    assert(depset_remove(&set, 99) == 0);
+    assert(set.size == 2 && set.capacity == 0);
+    assert(depset_remove(&set, 7) == 1);
+    assert(depset_contains(&set, 0) && !depset_contains(&set, 7));
+    printf("Duplicates and missing ids are no-ops - PASS\n\n");
+
+    printf("Test 2: Spilling into the table and shrinking back\n");
+    for (uint32_t id = 1; id <= DEPSET_INLINE; id++)
+        depset_insert(&set, id * 100);
+    assert(set.size == DEPSET_INLINE + 1 && set.capacity > 0);
+    for (uint32_t id = 1000; id < 1200; id++)
+        depset_insert(&set, id);
+    uint32_t grown = set.capacity;
+    assert(set.size * 2 <= grown);
+    for (uint32_t id = 1000; id < 1200; id++)
+        assert(depset_remove(&set, id) == 1);
+    assert(set.capacity > 0 && set.capacity < grown);
+    depset_remove(&set, 100);
+    depset_remove(&set, 200);
+    assert(set.capacity > 0 && set.size == DEPSET_INLINE / 2 + 1);
+    depset_remove(&set, 300);
+    assert(set.capacity == 0 && set.size == DEPSET_INLINE / 2);
+    assert(depset_contains(&set, 0) && depset_contains(&set, 400));
+    depset_free(&set);
+    assert(set.size == 0 && set.capacity == 0);
+    printf("Table grows, halves and gives way to inline ids - PASS\n\n");
+
+    printf("Test 3: Random inserts and removes against a reference\n");
+    srand(5);
+    depset_init(&set);
+    for (int round = 0; round < 20000; round++) {
+        // Clustered ids collide in the table and exercise the backward shift
+        uint32_t id = (round % 3 == 0) ? (uint32_t)(rand() % UNIVERSE) : (uint32_t)(rand() % 64) * 64;
+        int grow = (round / 2000) % 2 == 0;
+        if (rand() % 3 != 0 ? grow : !grow) {
+            assert(depset_insert(&set, id) == !present[id]);
+            present[id] = 1;
+        } else {
+            assert(depset_remove(&set, id) == present[id]);
+            present[id] = 0;
+        }
+        if (round % 997 == 0)
+            check_set(&set);
+    }
+    check_set(&set);
+    depset_free(&set);
+    printf("Contents match after 20000 operations - PASS\n\n");
+
+    printf("All depset tests passed!\n");
+    return 0;
+}
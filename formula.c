@@ -0,0 +1,218 @@
+// formula.c
+#include "formula.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Scans a cell name that spans exactly [s, end): letters, then a row without a leading zero
+static int scan_cell(const char *s, const char *end, int rows, int cols, uint32_t *id) {
+    const char *p = s;
+    int col = 0;
+    while (p < end && isalpha((unsigned char)*p)) {
+        col = col * 26 + (*p - 'A' + 1);
+        if (col > cols)
+            return 0;
+        p++;
+    }
+    if (p == s || p == end || *p == '0')
+        return 0;
+    int row = 0;
+    while (p < end && isdigit((unsigned char)*p)) {
+        row = row * 10 + (*p - '0');
+        if (row > rows)
+            return 0;
+        p++;
+    }
+    if (p != end)
+        return 0;
+    *id = (uint32_t)(row - 1) * cols + (col - 1);
+    return 1;
+}
+
+// Scans an arithmetic operand at *pos: a signed integer, or an unsigned upper case cell name
+static int scan_operand(const char **pos, const char *end, int rows, int cols, FormulaOperand *operand) {
+    const char *p = *pos;
+    int sign = 1;
+    if (p < end && (*p == '+' || *p == '-')) {
+        sign = (*p == '-') ? -1 : 1;
+        p++;
+    }
+    if (p < end && isdigit((unsigned char)*p)) {
+        // Constants wrap around like the int arithmetic they feed
+        uint32_t num = 0;
+        while (p < end && isdigit((unsigned char)*p)) {
+            num = num * 10 + (uint32_t)(*p - '0');
+            p++;
+        }
+        operand->value = (int32_t)(sign < 0 ? 0u - num : num);
+        operand->id = FORMULA_NO_CELL;
+    } else if (p < end && *p >= 'A' && *p <= 'Z' && p == *pos) {
+        const char *start = p;
+        while (p < end && *p >= 'A' && *p <= 'Z')
+            p++;
+        while (p < end && isdigit((unsigned char)*p))
+            p++;
+        if (!scan_cell(start, p, rows, cols, &operand->id))
+            return 0;
+        operand->value = 1;
+    } else {
+        return 0;
+    }
+    *pos = p;
+    return 1;
+}
+
+static int name_is(const char *name, size_t len, const char *expected) {
+    return strlen(expected) == len && strncasecmp(name, expected, len) == 0;
+}
+
+// FUNC(args) where args spans [args, end)
+static int parse_function(const char *name, size_t len, const char *args, const char *end,
+                          int rows, int cols, Formula *out) {
+    if (name_is(name, len, "SLEEP")) {
+        if (args == end)
+            return 0;
+        out->op = FORMULA_SLEEP;
+        char *num_end = NULL;
+        long val = strtol(args, &num_end, 10);
+        if (num_end == end) {
+            out->lhs.value = (int32_t)val;
+            return 1;
+        }
+        out->lhs.value = 1;
+        if (*args == '-' || *args == '+') {
+            out->lhs.value = (*args == '-') ? -1 : 1;
+            args++;
+        }
+        return scan_cell(args, end, rows, cols, &out->lhs.id);
+    }
+
+    static const char *names[] = {"MIN", "MAX", "SUM", "AVG", "STDEV"};
+    static const FormulaOp ops[] = {FORMULA_MIN, FORMULA_MAX, FORMULA_SUM, FORMULA_AVG, FORMULA_STDEV};
+    for (int i = 0; i < 5; i++) {
+        if (name_is(name, len, names[i]))
+            out->op = ops[i];
+    }
+    if (out->op == FORMULA_NONE)
+        return 0;
+
+    const char *colon = memchr(args, ':', end - args);
+    uint32_t first, last;
+    if (colon == NULL || !scan_cell(args, colon, rows, cols, &first) || !scan_cell(colon + 1, end, rows, cols, &last))
+        return 0;
+    out->r1 = first / cols + 1;
+    out->c1 = first % cols + 1;
+    out->r2 = last / cols + 1;
+    out->c2 = last % cols + 1;
+    return out->r1 <= out->r2 && out->c1 <= out->c2;
+}
+
+int formula_parse(const char *expr, int rows, int cols, Formula *out) {
+    memset(out, 0, sizeof(Formula));
+    out->lhs.id = FORMULA_NO_CELL;
+    out->rhs.id = FORMULA_NO_CELL;
+    if (expr == NULL || *expr == '\0')
+        return 0;
+
+    const char *end = expr + strlen(expr);
+    const char *p = expr;
+    while (isalpha((unsigned char)*p))
+        p++;
+
+    if (p > expr) {
+        // FUNC(args)
+        if (*p == '(' && end[-1] == ')')
+            return parse_function(expr, p - expr, p + 1, end - 1, rows, cols, out);
+
+        // A lone cell reference copies the cell, error flag included
+        const char *q = p;
+        while (isdigit((unsigned char)*q))
+            q++;
+        if (q > p && q == end) {
+            out->op = FORMULA_REF;
+            out->lhs.value = 1;
+            return scan_cell(expr, end, rows, cols, &out->lhs.id);
+        }
+    }
+
+    // Arithmetic: an operand, then optionally an operator and a second operand
+    p = expr;
+    if (!scan_operand(&p, end, rows, cols, &out->lhs))
+        return 0;
+    if (p == end) {
+        out->op = FORMULA_VALUE;
+        return 1;
+    }
+    switch (*p++) {
+    case '+':
+        out->op = FORMULA_ADD;
+        break;
+    case '-':
+        out->op = FORMULA_SUB;
+        break;
+    case '*':
+        out->op = FORMULA_MUL;
+        break;
+    case '/':
+        out->op = FORMULA_DIV;
+        break;
+    default:
+        return 0;
+    }
+    if (!scan_operand(&p, end, rows, cols, &out->rhs))
+        return 0;
+    return p == end;
+}
+
+// Cell name of an id, such as "AB12"
+static int format_cell(uint32_t id, int cols, char *buf, size_t size) {
+    int col = id % cols + 1;
+    char letters[8];
+    int len = 0;
+    while (col > 0) {
+        letters[len++] = 'A' + (col - 1) % 26;
+        col = (col - 1) / 26;
+    }
+    char name[8];
+    for (int i = 0; i < len; i++)
+        name[i] = letters[len - 1 - i];
+    name[len] = '\0';
+    return snprintf(buf, size, "%s%u", name, id / cols + 1);
+}
+
+static int format_operand(const FormulaOperand *operand, int cols, char *buf, size_t size) {
+    if (operand->id == FORMULA_NO_CELL)
+        return snprintf(buf, size, "%d", (int)operand->value);
+    int len = operand->value < 0 ? snprintf(buf, size, "-") : 0;
+    return len + format_cell(operand->id, cols, buf + len, size > (size_t)len ? size - len : 0);
+}
+
+int formula_format(const Formula *formula, int cols, char *buf, size_t size) {
+    static const char *names[] = {"MIN", "MAX", "SUM", "AVG", "STDEV"};
+    static const char symbols[] = "+-*/";
+    char lhs[24], rhs[24];
+    switch (formula->op) {
+    case FORMULA_NONE:
+        return snprintf(buf, size, "%s", "");
+    case FORMULA_VALUE:
+    case FORMULA_REF:
+        format_operand(&formula->lhs, cols, lhs, sizeof(lhs));
+        return snprintf(buf, size, "%s", lhs);
+    case FORMULA_SLEEP:
+        format_operand(&formula->lhs, cols, lhs, sizeof(lhs));
+        return snprintf(buf, size, "SLEEP(%s)", lhs);
+    default:
+        break;
+    }
+    if (formula_is_range(formula)) {
+        format_cell((uint32_t)(formula->r1 - 1) * cols + (formula->c1 - 1), cols, lhs, sizeof(lhs));
+        format_cell((uint32_t)(formula->r2 - 1) * cols + (formula->c2 - 1), cols, rhs, sizeof(rhs));
+        return snprintf(buf, size, "%s(%s:%s)", names[formula->op - FORMULA_MIN], lhs, rhs);
+    }
+    format_operand(&formula->lhs, cols, lhs, sizeof(lhs));
+    format_operand(&formula->rhs, cols, rhs, sizeof(rhs));
+    return snprintf(buf, size, "%s%c%s", lhs, symbols[formula->op - FORMULA_ADD], rhs);
+}
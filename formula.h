@@ -0,0 +1,102 @@
+// formula.h
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A formula compiled once when it is assigned, so recalculation never looks at the text
+typedef enum FormulaOp {
+    FORMULA_NONE = 0,   // cell has no formula
+    FORMULA_VALUE,      // lhs alone: a constant or a signed reference
+    FORMULA_REF,        // copy of a single cell, error flag included
+    FORMULA_ADD,
+    FORMULA_SUB,
+    FORMULA_MUL,
+    FORMULA_DIV,
+    FORMULA_MIN,
+    FORMULA_MAX,
+    FORMULA_SUM,
+    FORMULA_AVG,
+    FORMULA_STDEV,
+    FORMULA_SLEEP
+} FormulaOp;
+
+#define FORMULA_NO_CELL UINT32_MAX
+
+typedef struct FormulaOperand {
+    int32_t value;      // the constant, or the sign applied to the referenced cell
+    uint32_t id;        // referenced cell id, FORMULA_NO_CELL for a constant
+} FormulaOperand;
+
+typedef struct Formula {
+    uint8_t op;
+    FormulaOperand lhs;
+    FormulaOperand rhs;
+    int16_t r1;         // range rectangle of MIN/MAX/SUM/AVG/STDEV, 1-based
+    int16_t r2;
+    int16_t c1;
+    int16_t c2;
+} Formula;
+
+static inline int formula_is_range(const Formula *formula) {
+    return formula->op >= FORMULA_MIN && formula->op <= FORMULA_STDEV;
+}
+
+// A relative reference keeps the row and column offsets from the formula's own cell,
+// each biased into 16 bits. Rows and columns stay below 32768 so the high half is never
+// 0xffff and a reference never reads as FORMULA_NO_CELL
+#define FORMULA_OFFSET_BIAS 0x8000
+
+static inline uint32_t formula_relative_id(uint32_t id, int row, int col, int cols) {
+    int drow = (int)(id / cols) + 1 - row;
+    int dcol = (int)(id % cols) + 1 - col;
+    return (uint32_t)(drow + FORMULA_OFFSET_BIAS) << 16 | (uint32_t)(dcol + FORMULA_OFFSET_BIAS);
+}
+
+static inline uint32_t formula_absolute_id(uint32_t offset, int row, int col, int cols) {
+    int drow = (int)(offset >> 16) - FORMULA_OFFSET_BIAS;
+    int dcol = (int)(offset & 0xffff) - FORMULA_OFFSET_BIAS;
+    return (uint32_t)(row + drow - 1) * cols + (uint32_t)(col + dcol - 1);
+}
+
+// Rewrites the references of a formula held by (row, col) as offsets from that cell,
+// so formulas filled down or across share one shape
+static inline void formula_relative(const Formula *formula, int row, int col, int cols, Formula *shape) {
+    *shape = *formula;
+    if (formula->lhs.id != FORMULA_NO_CELL)
+        shape->lhs.id = formula_relative_id(formula->lhs.id, row, col, cols);
+    if (formula->rhs.id != FORMULA_NO_CELL)
+        shape->rhs.id = formula_relative_id(formula->rhs.id, row, col, cols);
+    if (formula_is_range(formula)) {
+        shape->r1 = formula->r1 - row;
+        shape->r2 = formula->r2 - row;
+        shape->c1 = formula->c1 - col;
+        shape->c2 = formula->c2 - col;
+    }
+}
+
+// Inverse of formula_relative, resolves a shape against the cell holding it
+static inline void formula_anchor(const Formula *shape, int row, int col, int cols, Formula *out) {
+    *out = *shape;
+    if (shape->lhs.id != FORMULA_NO_CELL)
+        out->lhs.id = formula_absolute_id(shape->lhs.id, row, col, cols);
+    if (shape->rhs.id != FORMULA_NO_CELL)
+        out->rhs.id = formula_absolute_id(shape->rhs.id, row, col, cols);
+    if (formula_is_range(shape)) {
+        out->r1 = shape->r1 + row;
+        out->r2 = shape->r2 + row;
+        out->c1 = shape->c1 + col;
+        out->c2 = shape->c2 + col;
+    }
+}
+
+// Parses the right-hand side of a command for a rows x cols sheet in a single pass.
+// Returns 1 if it is a valid formula, out is only meaningful in that case
+int formula_parse(const char *expr, int rows, int cols, Formula *out);
+
+// Writes the text of a formula for a sheet with cols columns, in the form formula_parse
+// reads back. Returns the length snprintf would, the text is cut to fit size
+int formula_format(const Formula *formula, int cols, char *buf, size_t size);
+
+#endif // FORMULA_H
@@ -0,0 +1,122 @@
+#include "formula.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define ROWS 100
+#define COLS 100
+
+// Cell id of a 1-based (row, col) on a ROWS x COLS sheet
+uint32_t id_of(int row, int col) {
+    return (uint32_t)(row - 1) * COLS + (col - 1);
+}
+
+// Helper function to check whether a formula is accepted
+void assert_valid(const char *expr, int expected) {
+    Formula formula;
+    int result = formula_parse(expr, ROWS, COLS, &formula);
+    printf("Parse \"%s\": %d (Expected: %d) - %s\n",
+           expr, result, expected,
+           result == expected ? "PASS" : "FAIL");
+    assert(result == expected);
+}
+
+int main() {
+    printf("=== Formula Test Suite ===\n\n");
+    Formula formula;
+
+    printf("Test 1: Constants and arithmetic\n");
+    assert(formula_parse("-0090", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_VALUE);
+    assert(formula.lhs.id == FORMULA_NO_CELL && formula.lhs.value == -90);
+
+    assert(formula_parse("B2*-7", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_MUL);
+    assert(formula.lhs.id == id_of(2, 2) && formula.lhs.value == 1);
+    assert(formula.rhs.id == FORMULA_NO_CELL && formula.rhs.value == -7);
+
+    assert(formula_parse("+3/C4", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_DIV);
+    assert(formula.lhs.value == 3 && formula.rhs.id == id_of(4, 3));
+
+    assert(formula_parse("-2147483648", ROWS, COLS, &formula));
+    assert(formula.lhs.value == -2147483647 - 1);
+    printf("PASS\n\n");
+
+    printf("Test 2: Cell references and functions\n");
+    assert(formula_parse("C3", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_REF && formula.lhs.id == id_of(3, 3));
+
+    assert(formula_parse("STDEV(B2:D9)", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_STDEV);
+    assert(formula.r1 == 2 && formula.r2 == 9 && formula.c1 == 2 && formula.c2 == 4);
+
+    // Function names are case insensitive
+    assert(formula_parse("max(A1:A3)", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_MAX);
+
+    assert(formula_parse("SLEEP(-B1)", ROWS, COLS, &formula));
+    assert(formula.op == FORMULA_SLEEP);
+    assert(formula.lhs.id == id_of(1, 2) && formula.lhs.value == -1);
+
+    assert(formula_parse("SLEEP(12)", ROWS, COLS, &formula));
+    assert(formula.lhs.id == FORMULA_NO_CELL && formula.lhs.value == 12);
+    printf("PASS\n\n");
+
+    printf("Test 3: Invalid formulas\n");
+    assert_valid("", 0);
+    assert_valid("A1 + A2", 0);
+    assert_valid("-A1", 0);
+    assert_valid("A1%2", 0);
+    assert_valid("A1+", 0);
+    assert_valid("A0", 0);
+    assert_valid("A01", 0);
+    assert_valid("A101", 0);
+    assert_valid("CW1", 0);
+    assert_valid("SUM(A1)", 0);
+    assert_valid("SUM(B1:A1)", 0);
+    assert_valid("SUM(A2:A1)", 0);
+    assert_valid("FOO(A1:B2)", 0);
+    assert_valid("SUM(A1:B2", 0);
+    assert_valid("SLEEP()", 0);
+    assert_valid("SLEEP(A1:A2)", 0);
+    assert_valid("CV100", 1);
+    assert_valid("AVG(A1:CV100)", 1);
+    printf("\n");
+
+    printf("Test 4: Formatting and relative shapes\n");
+    const char *texts[] = {"-90", "B2*-7", "3/C4", "CV100", "STDEV(B2:D9)", "SLEEP(-B1)", "SLEEP(12)",
+                           "A1+A1", "-2147483648"};
+    for (int i = 0; i < 9; i++) {
+        char buf[32];
+        Formula shape, back;
+        assert(formula_parse(texts[i], ROWS, COLS, &formula));
+        assert(formula_format(&formula, COLS, buf, sizeof(buf)) == (int)strlen(texts[i]));
+        printf("Format \"%s\": \"%s\"\n", texts[i], buf);
+        assert(strcmp(buf, texts[i]) == 0);
+        // A shape taken at one cell resolves back to the same formula there
+        formula_relative(&formula, 50, 60, COLS, &shape);
+        formula_anchor(&shape, 50, 60, COLS, &back);
+        formula_format(&back, COLS, buf, sizeof(buf));
+        assert(strcmp(buf, texts[i]) == 0);
+    }
+    // Filled down one row, every reference moves with it
+    Formula shape, moved;
+    char buf[32];
+    assert(formula_parse("MAX(A1:B10)", ROWS, COLS, &formula));
+    formula_relative(&formula, 1, 3, COLS, &shape);
+    formula_anchor(&shape, 2, 4, COLS, &moved);
+    formula_format(&moved, COLS, buf, sizeof(buf));
+    assert(strcmp(buf, "MAX(B2:C11)") == 0);
+    assert(formula_parse("CV100-A1", ROWS, COLS, &formula));
+    formula_relative(&formula, 100, 100, COLS, &shape);
+    formula_anchor(&shape, 1, 1, COLS, &moved);
+    assert(moved.lhs.id == id_of(1, 1));
+    // Text that does not fit is cut, the full length is still returned
+    assert(formula_format(&formula, COLS, buf, 4) == 8 && strcmp(buf, "CV1") == 0);
+    printf("PASS\n\n");
+
+    printf("All tests passed!\n");
+    return 0;
+}
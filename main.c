@@ -6,13 +6,76 @@
 #include <time.h>
 #include <unistd.h>
 
+// Applies every assignment line of a file as one bulk load. Lines that do not parse are
+// skipped and reported as an invalid command, rejected formulas as a cycle
+static void load_assignments(Spreadsheet *sheet, const char *path, char *status, size_t status_size) {
+    FILE *file = fopen(path, "r");
+    if(!file) {
+        safe_strcpy(status, status_size, "invalid command");
+        return;
+    }
+    BulkAssignment *items = NULL;
+    int count = 0, capacity = 0, invalid = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *equal_sign = strchr(line, '=');
+        if(!equal_sign) {
+            invalid |= line[0] != '\0';
+            continue;
+        }
+        *equal_sign = '\0';
+        if(count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            items = realloc(items, capacity * sizeof(BulkAssignment));
+            if(!items) {
+                perror("Failed to allocate memory");
+                exit(EXIT_FAILURE);
+            }
+        }
+        BulkAssignment *item = &items[count];
+        if(!spreadsheet_parse_command(sheet, line, equal_sign + 1, &item->row, &item->col, &item->formula)) {
+            invalid = 1;
+            continue;
+        }
+        count++;
+    }
+    fclose(file);
+
+    spreadsheet_assign_bulk(sheet, items, count);
+    safe_strcpy(status, status_size, invalid ? "invalid command" : "ok");
+    for(int i = 0; i < count; i++) {
+        if(!invalid && strcmp(items[i].status, "ok") != 0) {
+            safe_strcpy(status, status_size, items[i].status);
+        }
+    }
+    free(items);
+}
+
 int main(int argc, char *argv[]) {
     // fprintf(stderr, "Welcome to the spreadsheet program\n");
-    if(argc != 3) {
+    if(argc < 3) {
         // stderr is used for printing to console the error message : it does not buffer the output,immediate action
-        fprintf(stderr, "Usage: %s <rows> <cols>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <rows> <cols> [--prefix-sums] [--threads N] [--lazy]\n", argv[0]);
         return 1;
     }
+    // Optional flags after the dimensions
+    int prefix_sums = 0;
+    int threads = 1;
+    int lazy = 0;
+    for(int i = 3; i < argc; i++) {
+        if(strcmp(argv[i], "--prefix-sums") == 0) {
+            prefix_sums = 1;
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1) {
+            threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--lazy") == 0) {
+            // Edits only mark cells dirty, values are computed when displayed
+            lazy = 1;
+        } else {
+            fprintf(stderr, "Usage: %s <rows> <cols> [--prefix-sums] [--threads N] [--lazy]\n", argv[0]);
+            return 1;
+        }
+    }
     int rows = atoi(argv[1]);
     int cols = atoi(argv[2]);
     if(rows < 1 || rows > 999 || cols < 1 || cols > 18278) {
@@ -22,11 +85,22 @@ int main(int argc, char *argv[]) {
     double start_time = (double)time(NULL);
     // fprintf(stderr, "Before spreadsheet_create\n");
     Spreadsheet *sheet = spreadsheet_create(rows, cols);
+    if(sheet == NULL) {
+        return 1;
+    }
+    if(prefix_sums && !spreadsheet_enable_prefix_sums(sheet)) {
+        fprintf(stderr, "Space exceeded\n");
+    }
+    spreadsheet_set_threads(sheet, threads);
+    spreadsheet_set_lazy(sheet, lazy);
     // fprintf(stderr, "After spreadsheet_create\n");
     double elapsed_time = 0.0;
     char status[64];
     strcpy(status, "ok");
     int show = 1;
+    // Persistent recalc mode, and whether a begin is waiting for its commit
+    int manual = 0;
+    int transaction = 0;
 
     while(1) {
         // fprintf(stderr, "Displaying spreadsheet\n");
@@ -82,6 +156,34 @@ int main(int argc, char *argv[]) {
         } else if(strcmp(command, "enable_output") == 0){
             show = 1;
             strcpy(status, "ok");
+        } else if(strcmp(command, "begin") == 0){
+            // Assignments until commit are checked one by one and recalculated together
+            if(transaction) {
+                strcpy(status, "invalid command");
+            } else {
+                transaction = 1;
+                spreadsheet_set_manual(sheet, 1);
+                strcpy(status, "ok");
+            }
+        } else if(strcmp(command, "commit") == 0){
+            if(!transaction) {
+                strcpy(status, "invalid command");
+            } else {
+                transaction = 0;
+                spreadsheet_set_manual(sheet, manual);
+                strcpy(status, "ok");
+            }
+        } else if(strcmp(command, "recalc") == 0){
+            spreadsheet_recalc_pending(sheet);
+            strcpy(status, "ok");
+        } else if(strcmp(command, "recalc manual") == 0 || strcmp(command, "recalc auto") == 0){
+            manual = command[7] == 'm';
+            if(!transaction) {
+                spreadsheet_set_manual(sheet, manual);
+            }
+            strcpy(status, "ok");
+        } else if(strncmp(command, "load ", 5) == 0){
+            load_assignments(sheet, command + 5, status, sizeof(status));
         } else if(strncmp(command, "scroll_to", 9) == 0){
             // Parse scroll_to command like scroll_to A1
             const char *cell_name = command + 10;
@@ -102,12 +204,15 @@ int main(int argc, char *argv[]) {
 
                 char *cell_name = command;
                 char *formula = equal_sign + 1;
-                if(!is_valid_command(sheet, &cell_name, &formula)) {
+                // The command is scanned once, assignment works on the parse result
+                int row, col;
+                Formula parsed;
+                if(!spreadsheet_parse_command(sheet, cell_name, formula, &row, &col, &parsed)) {
 
                     strcpy(status, "invalid command");
                 } else {
                     // fprintf(stderr, "[DEBUG] Command: %s = %s\n", cell_name, formula);
-                    spreadsheet_set_cell_value(sheet, cell_name, formula, status, sizeof(status));
+                    spreadsheet_assign_formula(sheet, row, col, &parsed, status, sizeof(status));
                 }
             } else {
                 // elapsed_time = 0.0;
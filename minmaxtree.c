@@ -0,0 +1,184 @@
+// minmaxtree.c
+#include "minmaxtree.h"
+#include "rangekernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int min_int(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+static int max_int(int a, int b) {
+    return (a > b) ? a : b;
+}
+
+static size_t node_index(const MinMaxTree *tree, int i, int j) {
+    return (size_t)i * 2 * tree->size_cols + j;
+}
+
+// Scans the cells of a rectangle (1-based, inclusive) into the running min and max
+static void scan_cells(const MinMaxTree *tree, int r1, int r2, int c1, int c2, int *min, int *max) {
+    if (r1 > r2 || c1 > c2)
+        return;
+    for (int r = r1; r <= r2; r++) {
+        const int32_t *row = tree->values + (size_t)(r - 1) * tree->cols + (c1 - 1);
+        *min = min_int(*min, kernel_min(row, c2 - c1 + 1));
+        *max = max_int(*max, kernel_max(row, c2 - c1 + 1));
+    }
+}
+
+// Recomputes the leaf of tile (tr, tc) from its cells
+static void scan_tile(const MinMaxTree *tree, int tr, int tc, int *min, int *max) {
+    *min = INT32_MAX;
+    *max = INT32_MIN;
+    int r1 = tr * MINMAX_TILE + 1;
+    int c1 = tc * MINMAX_TILE + 1;
+    scan_cells(tree, r1, min_int(r1 + MINMAX_TILE - 1, tree->rows),
+               c1, min_int(c1 + MINMAX_TILE - 1, tree->cols), min, max);
+}
+
+static void pull_up(MinMaxTree *tree, int i, int j) {
+    size_t node = node_index(tree, i, j);
+    if (i >= tree->size_rows) {
+        // Leaf row: combine along the columns
+        size_t left = node_index(tree, i, 2 * j), right = left + 1;
+        tree->min[node] = min_int(tree->min[left], tree->min[right]);
+        tree->max[node] = max_int(tree->max[left], tree->max[right]);
+    } else {
+        size_t top = node_index(tree, 2 * i, j), bottom = node_index(tree, 2 * i + 1, j);
+        tree->min[node] = min_int(tree->min[top], tree->min[bottom]);
+        tree->max[node] = max_int(tree->max[top], tree->max[bottom]);
+    }
+}
+
+MinMaxTree* minmaxtree_create(const int32_t *values, int rows, int cols) {
+    MinMaxTree *tree = malloc(sizeof(MinMaxTree));
+    if (!tree) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    tree->values = values;
+    tree->rows = rows;
+    tree->cols = cols;
+    tree->tile_rows = (rows + MINMAX_TILE - 1) / MINMAX_TILE;
+    tree->tile_cols = (cols + MINMAX_TILE - 1) / MINMAX_TILE;
+    tree->size_rows = 1;
+    while (tree->size_rows < tree->tile_rows)
+        tree->size_rows <<= 1;
+    tree->size_cols = 1;
+    while (tree->size_cols < tree->tile_cols)
+        tree->size_cols <<= 1;
+
+    size_t nodes = (size_t)4 * tree->size_rows * tree->size_cols;
+    tree->min = malloc(nodes * sizeof(int32_t));
+    tree->max = malloc(nodes * sizeof(int32_t));
+    if (!tree->min || !tree->max) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    // Leaves past the grid are neutral
+    for (size_t n = 0; n < nodes; n++) {
+        tree->min[n] = INT32_MAX;
+        tree->max[n] = INT32_MIN;
+    }
+    for (int tr = 0; tr < tree->tile_rows; tr++) {
+        for (int tc = 0; tc < tree->tile_cols; tc++) {
+            size_t leaf = node_index(tree, tree->size_rows + tr, tree->size_cols + tc);
+            scan_tile(tree, tr, tc, &tree->min[leaf], &tree->max[leaf]);
+        }
+    }
+    for (int i = tree->size_rows; i < 2 * tree->size_rows; i++)
+        for (int j = tree->size_cols - 1; j > 0; j--)
+            pull_up(tree, i, j);
+    for (int i = tree->size_rows - 1; i > 0; i--)
+        for (int j = 1; j < 2 * tree->size_cols; j++)
+            pull_up(tree, i, j);
+    return tree;
+}
+
+// Called after the value at (row, col) changed from old_value to new_value
+void minmaxtree_update(MinMaxTree *tree, int row, int col, int old_value, int new_value) {
+    int tr = (row - 1) / MINMAX_TILE;
+    int tc = (col - 1) / MINMAX_TILE;
+    int leaf_row = tree->size_rows + tr;
+    int leaf_col = tree->size_cols + tc;
+    size_t leaf = node_index(tree, leaf_row, leaf_col);
+    int min = tree->min[leaf], max = tree->max[leaf];
+
+    if ((old_value == min && new_value > old_value) || (old_value == max && new_value < old_value)) {
+        // The tile may have lost its extremum, only its own cells can tell
+        scan_tile(tree, tr, tc, &min, &max);
+    } else {
+        min = min_int(min, new_value);
+        max = max_int(max, new_value);
+    }
+    if (min == tree->min[leaf] && max == tree->max[leaf])
+        return;
+    tree->min[leaf] = min;
+    tree->max[leaf] = max;
+
+    for (int j = leaf_col >> 1; j > 0; j >>= 1)
+        pull_up(tree, leaf_row, j);
+    for (int i = leaf_row >> 1; i > 0; i >>= 1)
+        for (int j = leaf_col; j > 0; j >>= 1)
+            pull_up(tree, i, j);
+}
+
+// Combines the tree nodes of tree row i over the leaf columns [lo, hi)
+static void query_columns(const MinMaxTree *tree, int i, int lo, int hi, int *min, int *max) {
+    for (lo += tree->size_cols, hi += tree->size_cols; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1) {
+            size_t node = node_index(tree, i, lo++);
+            *min = min_int(*min, tree->min[node]);
+            *max = max_int(*max, tree->max[node]);
+        }
+        if (hi & 1) {
+            size_t node = node_index(tree, i, --hi);
+            *min = min_int(*min, tree->min[node]);
+            *max = max_int(*max, tree->max[node]);
+        }
+    }
+}
+
+// Min and max of the rectangle r1..r2 x c1..c2 (1-based, inclusive)
+void minmaxtree_query(const MinMaxTree *tree, int r1, int r2, int c1, int c2, int *min, int *max) {
+    *min = INT32_MAX;
+    *max = INT32_MIN;
+
+    // Tiles lying entirely inside the rectangle, tiles on the last row/column end at the grid
+    int tr1 = (r1 - 1 + MINMAX_TILE - 1) / MINMAX_TILE;
+    int tr2 = (r2 == tree->rows) ? tree->tile_rows - 1 : r2 / MINMAX_TILE - 1;
+    int tc1 = (c1 - 1 + MINMAX_TILE - 1) / MINMAX_TILE;
+    int tc2 = (c2 == tree->cols) ? tree->tile_cols - 1 : c2 / MINMAX_TILE - 1;
+    if (tr1 > tr2 || tc1 > tc2) {
+        scan_cells(tree, r1, r2, c1, c2, min, max);
+        return;
+    }
+
+    int lo = tr1 + tree->size_rows, hi = tr2 + 1 + tree->size_rows;
+    for (; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1)
+            query_columns(tree, lo++, tc1, tc2 + 1, min, max);
+        if (hi & 1)
+            query_columns(tree, --hi, tc1, tc2 + 1, min, max);
+    }
+
+    // Border strips around the covered tiles
+    int inner_r1 = tr1 * MINMAX_TILE + 1;
+    int inner_r2 = min_int((tr2 + 1) * MINMAX_TILE, tree->rows);
+    int inner_c1 = tc1 * MINMAX_TILE + 1;
+    int inner_c2 = min_int((tc2 + 1) * MINMAX_TILE, tree->cols);
+    scan_cells(tree, r1, inner_r1 - 1, c1, c2, min, max);
+    scan_cells(tree, inner_r2 + 1, r2, c1, c2, min, max);
+    scan_cells(tree, inner_r1, inner_r2, c1, inner_c1 - 1, min, max);
+    scan_cells(tree, inner_r1, inner_r2, inner_c2 + 1, c2, min, max);
+}
+
+void minmaxtree_destroy(MinMaxTree *tree) {
+    if (tree == NULL)
+        return;
+    free(tree->min);
+    free(tree->max);
+    free(tree);
+}
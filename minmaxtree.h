@@ -0,0 +1,30 @@
+// minmaxtree.h
+#ifndef MINMAXTREE_H
+#define MINMAXTREE_H
+
+#include <stdint.h>
+
+// The grid is summarised in MINMAX_TILE x MINMAX_TILE tiles
+#define MINMAX_TILE 32
+
+// Tiled MIN/MAX summaries of a row-major value grid, with a 2D segment tree over the
+// tiles. A rectangle query combines the fully covered tiles through the tree and
+// scans only the partial tiles along its border.
+typedef struct MinMaxTree {
+    const int32_t *values;  // the grid being summarised, rows x cols, row-major
+    int rows;
+    int cols;
+    int tile_rows;
+    int tile_cols;
+    int size_rows;          // leaf counts of the tree, powers of two
+    int size_cols;
+    int32_t *min;           // (2 * size_rows) x (2 * size_cols) nodes
+    int32_t *max;
+} MinMaxTree;
+
+MinMaxTree* minmaxtree_create(const int32_t *values, int rows, int cols);
+void minmaxtree_update(MinMaxTree *tree, int row, int col, int old_value, int new_value);
+void minmaxtree_query(const MinMaxTree *tree, int r1, int r2, int c1, int c2, int *min, int *max);
+void minmaxtree_destroy(MinMaxTree *tree);
+
+#endif // MINMAXTREE_H
@@ -0,0 +1,86 @@
+#include "minmaxtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define ROWS 101
+#define COLS 150
+
+int32_t grid[ROWS * COLS];
+
+// Reference min and max of a rectangle by scanning it
+void scan_range(int r1, int r2, int c1, int c2, int *min, int *max) {
+    *min = INT32_MAX;
+    *max = INT32_MIN;
+    for (int r = r1; r <= r2; r++) {
+        for (int c = c1; c <= c2; c++) {
+            int v = grid[(r - 1) * COLS + (c - 1)];
+            if (v < *min) *min = v;
+            if (v > *max) *max = v;
+        }
+    }
+}
+
+// Helper function to compare a rectangle against the scan
+void assert_range(MinMaxTree *tree, int r1, int r2, int c1, int c2) {
+    int min, max, expected_min, expected_max;
+    minmaxtree_query(tree, r1, r2, c1, c2, &min, &max);
+    scan_range(r1, r2, c1, c2, &expected_min, &expected_max);
+    if (min != expected_min || max != expected_max)
+        printf("Range (%d..%d, %d..%d): min %d max %d (Expected: %d %d) - FAIL\n",
+               r1, r2, c1, c2, min, max, expected_min, expected_max);
+    assert(min == expected_min && max == expected_max);
+}
+
+void set_value(MinMaxTree *tree, int row, int col, int value) {
+    int old = grid[(row - 1) * COLS + (col - 1)];
+    grid[(row - 1) * COLS + (col - 1)] = value;
+    minmaxtree_update(tree, row, col, old, value);
+}
+
+void random_queries(MinMaxTree *tree, int count) {
+    for (int i = 0; i < count; i++) {
+        int r1 = 1 + rand() % ROWS, r2 = 1 + rand() % ROWS;
+        int c1 = 1 + rand() % COLS, c2 = 1 + rand() % COLS;
+        if (r1 > r2) { int t = r1; r1 = r2; r2 = t; }
+        if (c1 > c2) { int t = c1; c1 = c2; c2 = t; }
+        assert_range(tree, r1, r2, c1, c2);
+    }
+}
+
+int main() {
+    printf("=== MinMaxTree Test Suite ===\n\n");
+    srand(11);
+    for (int i = 0; i < ROWS * COLS; i++)
+        grid[i] = rand() % 20001 - 10000;
+
+    printf("Test 1: Creation over an existing grid\n");
+    MinMaxTree *tree = minmaxtree_create(grid, ROWS, COLS);
+    assert(tree != NULL);
+    assert(tree->tile_rows == 4 && tree->tile_cols == 5);
+    assert_range(tree, 1, ROWS, 1, COLS);
+    assert_range(tree, 1, 1, 1, 1);
+    assert_range(tree, 33, 64, 33, 64);     // exactly one tile
+    assert_range(tree, 97, ROWS, 129, COLS); // the clipped corner tile
+    printf("Whole grid, single cell and tile aligned ranges - PASS\n\n");
+
+    printf("Test 2: Random rectangles\n");
+    random_queries(tree, 500);
+    printf("500 random rectangles - PASS\n\n");
+
+    printf("Test 3: Point updates\n");
+    set_value(tree, 50, 70, -50000);
+    assert_range(tree, 1, ROWS, 1, COLS);
+    set_value(tree, 50, 70, 0);         // the only minimum goes away
+    assert_range(tree, 1, ROWS, 1, COLS);
+    set_value(tree, ROWS, COLS, 99999);
+    assert_range(tree, 90, ROWS, 100, COLS);
+    for (int i = 0; i < 3000; i++)
+        set_value(tree, 1 + rand() % ROWS, 1 + rand() % COLS, rand() % 20001 - 10000);
+    random_queries(tree, 500);
+    printf("3000 updates, 500 random rectangles - PASS\n\n");
+
+    minmaxtree_destroy(tree);
+    printf("All tests passed!\n");
+    return 0;
+}
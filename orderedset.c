@@ -4,7 +4,6 @@
 #include "orderedset.h"
 
 #include <stdlib.h>
-#include <string.h> // Added for strdup
 #include <stdio.h>
 #include <ctype.h>
 #include <strings.h>
@@ -58,19 +57,18 @@ static int get_balance(OrderedSetNode *node) {
     return height_node(node->left) - height_node(node->right);
 }
 
-static OrderedSetNode* orderedset_insert_node(OrderedSetNode* node, const char *key) {
+static OrderedSetNode* orderedset_insert_node(OrderedSetNode* node, uint32_t key) {
     if (node == NULL) {
         OrderedSetNode* new_node = malloc(sizeof(OrderedSetNode));
-        new_node->key = strdup(key);
+        new_node->key = key;
         new_node->left = new_node->right = NULL;
         new_node->height = 1;
         return new_node;
     }
     
-    int cmp = strcmp(key, node->key);
-    if (cmp < 0)
+    if (key < node->key)
         node->left = orderedset_insert_node(node->left, key);
-    else if (cmp > 0)
+    else if (key > node->key)
         node->right = orderedset_insert_node(node->right, key);
     else // Duplicate keys not allowed
         return node;
@@ -83,21 +81,21 @@ static OrderedSetNode* orderedset_insert_node(OrderedSetNode* node, const char *
     
     // Balance the tree
     // Left Left
-    if (balance > 1 && strcmp(key, node->left->key) < 0)
+    if (balance > 1 && key < node->left->key)
         return right_rotate(node);
     
     // Right Right
-    if (balance < -1 && strcmp(key, node->right->key) > 0)
+    if (balance < -1 && key > node->right->key)
         return left_rotate(node);
     
     // Left Right
-    if (balance > 1 && strcmp(key, node->left->key) > 0) {
+    if (balance > 1 && key > node->left->key) {
         node->left = left_rotate(node->left);
         return right_rotate(node);
     }
     
     // Right Left
-    if (balance < -1 && strcmp(key, node->right->key) < 0) {
+    if (balance < -1 && key < node->right->key) {
         node->right = right_rotate(node->right);
         return left_rotate(node);
     }
@@ -111,23 +109,22 @@ OrderedSet* orderedset_create() {
     return set;
 }
 
-void orderedset_insert(OrderedSet *set, const char *key) {
+void orderedset_insert(OrderedSet *set, uint32_t key) {
     set->root = orderedset_insert_node(set->root, key);
 }
 
-static int orderedset_contains_node(OrderedSetNode *node, const char *key) {
+static int orderedset_contains_node(OrderedSetNode *node, uint32_t key) {
     if (node == NULL)
         return 0;
-    int cmp = strcmp(key, node->key);
-    if (cmp < 0)
+    if (key < node->key)
         return orderedset_contains_node(node->left, key);
-    else if (cmp > 0)
+    else if (key > node->key)
         return orderedset_contains_node(node->right, key);
     else
         return 1;
 }
 
-int orderedset_contains(OrderedSet *set, const char *key) {
+int orderedset_contains(OrderedSet *set, uint32_t key) {
     return orderedset_contains_node(set->root, key);
 }
 
@@ -136,7 +133,6 @@ static void orderedset_destroy_node(OrderedSetNode *node) {
         return;
     orderedset_destroy_node(node->left);
     orderedset_destroy_node(node->right);
-    free(node->key);
     free(node);
 }
 
@@ -147,7 +143,7 @@ void orderedset_destroy(OrderedSet *set) {
     free(set);
 }
 
-static void orderedset_inorder_traversal_helper(OrderedSetNode *node, void (*func)(const char*)) {
+static void orderedset_inorder_traversal_helper(OrderedSetNode *node, void (*func)(uint32_t)) {
     if (node == NULL)
         return;
     orderedset_inorder_traversal_helper(node->left, func);
@@ -155,18 +151,31 @@ static void orderedset_inorder_traversal_helper(OrderedSetNode *node, void (*fun
     orderedset_inorder_traversal_helper(node->right, func);
 }
 
-void orderedset_inorder_traversal(OrderedSet *set, void (*func)(const char*)) {
+void orderedset_inorder_traversal(OrderedSet *set, void (*func)(uint32_t)) {
     orderedset_inorder_traversal_helper(set->root, func);
 }
 
+static void orderedset_foreach_helper(OrderedSetNode *node, void (*func)(uint32_t, void*), void *ctx) {
+    if (node == NULL)
+        return;
+    orderedset_foreach_helper(node->left, func, ctx);
+    func(node->key, ctx);
+    orderedset_foreach_helper(node->right, func, ctx);
+}
+
+// In-order traversal that passes a caller supplied context to every visit
+void orderedset_foreach(OrderedSet *set, void (*func)(uint32_t, void*), void *ctx) {
+    orderedset_foreach_helper(set->root, func, ctx);
+}
+
 // void orderedset_print(OrderedSet *set) {
 //     orderedset_inorder_traversal(set, puts);
 // }
 
 
 // Add the wrapper function
-void print_node(const char *str) {
-    puts(str);
+void print_node(uint32_t key) {
+    printf("%u\n", key);
 }
 
 void orderedset_print(OrderedSet *set) {
@@ -185,24 +194,21 @@ static OrderedSetNode* find_min(OrderedSetNode *node) {
 }
 
 // Helper function to remove a node from the set
-static OrderedSetNode* remove_node(OrderedSetNode *root, const char *key) {
+static OrderedSetNode* remove_node(OrderedSetNode *root, uint32_t key) {
     if (root == NULL) return NULL;
 
-    int cmp = strcmp(key, root->key);
-    if (cmp < 0) {
+    if (key < root->key) {
         root->left = remove_node(root->left, key);
-    } else if (cmp > 0) {
+    } else if (key > root->key) {
         root->right = remove_node(root->right, key);
     } else {
         // Node with only one child or no child
         if (root->left == NULL) {
             OrderedSetNode *temp = root->right;
-            free(root->key);
             free(root);
             return temp;
         } else if (root->right == NULL) {
             OrderedSetNode *temp = root->left;
-            free(root->key);
             free(root);
             return temp;
         }
@@ -211,8 +217,7 @@ static OrderedSetNode* remove_node(OrderedSetNode *root, const char *key) {
         OrderedSetNode *temp = find_min(root->right);
 
         // Copy the inorder successor's content to this node
-        free(root->key);
-        root->key = strdup(temp->key);
+        root->key = temp->key;
 
         // Delete the inorder successor
         root->right = remove_node(root->right, temp->key);
@@ -238,7 +243,7 @@ static OrderedSetNode* remove_node(OrderedSetNode *root, const char *key) {
     return root;
 }
 
-void orderedset_remove(OrderedSet *set, const char *key) {
+void orderedset_remove(OrderedSet *set, uint32_t key) {
     set->root = remove_node(set->root, key);
 }
 
@@ -247,7 +252,6 @@ void clear_node(OrderedSetNode *node) {
         if (node == NULL) return;
         clear_node(node->left);
         clear_node(node->right);
-        free(node->key);
         free(node);
     }
 
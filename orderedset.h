@@ -2,8 +2,11 @@
 #ifndef ORDEREDSET_H
 #define ORDEREDSET_H
 
+#include <stdint.h>
+
+// AVL tree of cell ids
 typedef struct OrderedSetNode {
-    char *key;
+    uint32_t key;
     struct OrderedSetNode *left;
     struct OrderedSetNode *right;
     int height;
@@ -14,11 +17,12 @@ typedef struct OrderedSet {
 } OrderedSet;
 
 OrderedSet* orderedset_create();
-void orderedset_insert(OrderedSet *set, const char *key);
-void orderedset_remove(OrderedSet *set, const char *key);
-int orderedset_contains(OrderedSet *set, const char *key);
+void orderedset_insert(OrderedSet *set, uint32_t key);
+void orderedset_remove(OrderedSet *set, uint32_t key);
+int orderedset_contains(OrderedSet *set, uint32_t key);
 void orderedset_destroy(OrderedSet *set);
-void orderedset_inorder_traversal(OrderedSet *set, void (*func)(const char*));
+void orderedset_inorder_traversal(OrderedSet *set, void (*func)(uint32_t));
+void orderedset_foreach(OrderedSet *set, void (*func)(uint32_t, void*), void *ctx);
 void orderedset_print(OrderedSet *set);
 void orderedset_clear(OrderedSet *set);
 
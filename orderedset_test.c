@@ -4,14 +4,14 @@
 #include <string.h>
 #include <assert.h>
 
-void print_key(const char *key) {
-    printf("%s ", key);
+void print_key(uint32_t key) {
+    printf("%u ", key);
 }
 
 // Helper function to test if an element exists in the set
-void assert_contains(OrderedSet *set, const char *key, int expected) {
+void assert_contains(OrderedSet *set, uint32_t key, int expected) {
     int result = orderedset_contains(set, key);
-    printf("Contains %s: %d (Expected: %d) - %s\n", 
+    printf("Contains %u: %d (Expected: %d) - %s\n", 
            key, result, expected, 
            result == expected ? "PASS" : "FAIL");
     assert(result == expected);
@@ -19,7 +19,7 @@ void assert_contains(OrderedSet *set, const char *key, int expected) {
 
 // Helper to count elements during traversal
 int element_count = 0;
-void count_element(const char *key) {
+void count_element(uint32_t key) {
     element_count++;
     print_key(key);
 }
@@ -31,21 +31,21 @@ int main() {
     OrderedSet *set = orderedset_create();
     assert(set != NULL);
     
-    orderedset_insert(set, "A1");
-    orderedset_insert(set, "B2");
-    orderedset_insert(set, "C3");
+    orderedset_insert(set, 0);
+    orderedset_insert(set, 101);
+    orderedset_insert(set, 202);
     
-    assert_contains(set, "A1", 1);
-    assert_contains(set, "B2", 1);
-    assert_contains(set, "C3", 1);
-    assert_contains(set, "D4", 0);
+    assert_contains(set, 0, 1);
+    assert_contains(set, 101, 1);
+    assert_contains(set, 202, 1);
+    assert_contains(set, 303, 0);
     
     printf("In-order traversal: ");
     orderedset_inorder_traversal(set, print_key);
     printf("\n\n");
     
     printf("Test 2: Duplicate insertion\n");
-    orderedset_insert(set, "A1");  // Duplicates should be ignored
+    orderedset_insert(set, 0);  // Duplicates should be ignored
     
     // Count should still be 3
     element_count = 0;
@@ -56,10 +56,10 @@ int main() {
     assert(element_count == 3);
     
     printf("Test 3: Removal\n");
-    orderedset_remove(set, "B2");
-    assert_contains(set, "B2", 0);
-    assert_contains(set, "A1", 1);
-    assert_contains(set, "C3", 1);
+    orderedset_remove(set, 101);
+    assert_contains(set, 101, 0);
+    assert_contains(set, 0, 1);
+    assert_contains(set, 202, 1);
     
     element_count = 0;
     printf("Elements after removal: ");
@@ -69,7 +69,7 @@ int main() {
     assert(element_count == 2);
     
     printf("Test 4: Removing non-existent element\n");
-    orderedset_remove(set, "X9");  // Should not crash
+    orderedset_remove(set, 823);  // Should not crash
     element_count = 0;
     printf("Elements after attempted removal of non-existent item: ");
     orderedset_inorder_traversal(set, count_element);
@@ -79,10 +79,10 @@ int main() {
     
     printf("Test 5: Complex insertion and removal (AVL balancing)\n");
     // Insert more elements to test tree balancing
-    orderedset_insert(set, "D4");
-    orderedset_insert(set, "E5");
-    orderedset_insert(set, "F6");
-    orderedset_insert(set, "G7");
+    orderedset_insert(set, 303);
+    orderedset_insert(set, 404);
+    orderedset_insert(set, 505);
+    orderedset_insert(set, 606);
     
     element_count = 0;
     printf("Elements after complex insertion: ");
@@ -92,8 +92,8 @@ int main() {
     assert(element_count == 6);
     
     // Remove nodes to test different rebalancing cases
-    orderedset_remove(set, "A1");
-    orderedset_remove(set, "C3");
+    orderedset_remove(set, 0);
+    orderedset_remove(set, 202);
     
     element_count = 0;
     printf("Elements after complex removal: ");
@@ -110,15 +110,15 @@ int main() {
     printf("\nCount: %d (Expected: 0) - %s\n\n", 
            element_count, element_count == 0 ? "PASS" : "FAIL");
     assert(element_count == 0);
-    assert_contains(set, "D4", 0);
+    assert_contains(set, 303, 0);
     
     printf("Test 7: Insert after clear\n");
-    orderedset_insert(set, "Z26");
-    assert_contains(set, "Z26", 1);
+    orderedset_insert(set, 2525);
+    assert_contains(set, 2525, 1);
     
-    printf("Test 8: Edge cases - empty strings\n");
-    orderedset_insert(set, "");
-    assert_contains(set, "", 1);
+    printf("Test 8: Edge cases - largest id\n");
+    orderedset_insert(set, UINT32_MAX);
+    assert_contains(set, UINT32_MAX, 1);
     
     element_count = 0;
     printf("Final elements: ");
@@ -0,0 +1,57 @@
+// prefixsum.c
+#include "prefixsum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+PrefixSum* prefixsum_create(int rows, int cols) {
+    PrefixSum *ps = malloc(sizeof(PrefixSum));
+    if (!ps) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    ps->rows = rows;
+    ps->cols = cols;
+    // All values start at zero, so does every partial sum
+    ps->tree = calloc((size_t)(rows + 1) * (cols + 1), sizeof(int64_t));
+    if (!ps->tree) {
+        free(ps);
+        return NULL;
+    }
+    return ps;
+}
+
+// Adds delta to the value at (row, col), both 1-based
+void prefixsum_add(PrefixSum *ps, int row, int col, int64_t delta) {
+    size_t stride = (size_t)ps->cols + 1;
+    for (int r = row; r <= ps->rows; r += r & -r) {
+        int64_t *line = ps->tree + r * stride;
+        for (int c = col; c <= ps->cols; c += c & -c)
+            line[c] += delta;
+    }
+}
+
+// Sum of the rectangle from (1, 1) to (row, col)
+int64_t prefixsum_query(const PrefixSum *ps, int row, int col) {
+    size_t stride = (size_t)ps->cols + 1;
+    int64_t sum = 0;
+    for (int r = row; r > 0; r -= r & -r) {
+        const int64_t *line = ps->tree + r * stride;
+        for (int c = col; c > 0; c -= c & -c)
+            sum += line[c];
+    }
+    return sum;
+}
+
+// Sum of the rectangle r1..r2 x c1..c2 from its four corners
+int64_t prefixsum_range(const PrefixSum *ps, int r1, int r2, int c1, int c2) {
+    return prefixsum_query(ps, r2, c2) - prefixsum_query(ps, r1 - 1, c2)
+         - prefixsum_query(ps, r2, c1 - 1) + prefixsum_query(ps, r1 - 1, c1 - 1);
+}
+
+void prefixsum_destroy(PrefixSum *ps) {
+    if (ps == NULL)
+        return;
+    free(ps->tree);
+    free(ps);
+}
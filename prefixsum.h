@@ -0,0 +1,22 @@
+// prefixsum.h
+#ifndef PREFIXSUM_H
+#define PREFIXSUM_H
+
+#include <stdint.h>
+
+// Maintained 2D prefix sums of the cell values, kept as a 2D Fenwick tree so a store
+// costs O(log rows * log cols) instead of rebuilding a summed-area table. Any
+// rectangle sum is the usual four corner lookups.
+typedef struct PrefixSum {
+    int rows;
+    int cols;
+    int64_t *tree;      // (rows + 1) x (cols + 1), row 0 and column 0 unused
+} PrefixSum;
+
+PrefixSum* prefixsum_create(int rows, int cols);
+void prefixsum_add(PrefixSum *ps, int row, int col, int64_t delta);
+int64_t prefixsum_query(const PrefixSum *ps, int row, int col);
+int64_t prefixsum_range(const PrefixSum *ps, int r1, int r2, int c1, int c2);
+void prefixsum_destroy(PrefixSum *ps);
+
+#endif // PREFIXSUM_H
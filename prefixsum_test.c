@@ -0,0 +1,76 @@
+#include "prefixsum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define ROWS 37
+#define COLS 53
+
+int grid[ROWS + 1][COLS + 1];
+
+// Reference sum of a rectangle by scanning it
+int64_t scan_sum(int r1, int r2, int c1, int c2) {
+    int64_t sum = 0;
+    for (int r = r1; r <= r2; r++)
+        for (int c = c1; c <= c2; c++)
+            sum += grid[r][c];
+    return sum;
+}
+
+// Helper function to compare a rectangle against the scan
+void assert_range(PrefixSum *ps, int r1, int r2, int c1, int c2) {
+    int64_t result = prefixsum_range(ps, r1, r2, c1, c2);
+    int64_t expected = scan_sum(r1, r2, c1, c2);
+    if (result != expected)
+        printf("Range (%d..%d, %d..%d): %lld (Expected: %lld) - FAIL\n",
+               r1, r2, c1, c2, (long long)result, (long long)expected);
+    assert(result == expected);
+}
+
+int main() {
+    printf("=== PrefixSum Test Suite ===\n\n");
+
+    printf("Test 1: Creation\n");
+    PrefixSum *ps = prefixsum_create(ROWS, COLS);
+    assert(ps != NULL);
+    assert(prefixsum_query(ps, ROWS, COLS) == 0);
+    printf("Empty grid sums to 0 - PASS\n\n");
+
+    printf("Test 2: Single updates\n");
+    prefixsum_add(ps, 1, 1, 5);
+    grid[1][1] = 5;
+    prefixsum_add(ps, ROWS, COLS, -7);
+    grid[ROWS][COLS] = -7;
+    assert(prefixsum_query(ps, 1, 1) == 5);
+    assert(prefixsum_query(ps, ROWS, COLS) == -2);
+    assert_range(ps, 2, ROWS, 2, COLS);
+    printf("Corner updates - PASS\n\n");
+
+    printf("Test 3: Random updates against a full scan\n");
+    srand(7);
+    for (int i = 0; i < 2000; i++) {
+        int r = 1 + rand() % ROWS, c = 1 + rand() % COLS;
+        int value = rand() % 2001 - 1000;
+        prefixsum_add(ps, r, c, (int64_t)value - grid[r][c]);
+        grid[r][c] = value;
+    }
+    for (int i = 0; i < 500; i++) {
+        int r1 = 1 + rand() % ROWS, r2 = 1 + rand() % ROWS;
+        int c1 = 1 + rand() % COLS, c2 = 1 + rand() % COLS;
+        if (r1 > r2) { int t = r1; r1 = r2; r2 = t; }
+        if (c1 > c2) { int t = c1; c1 = c2; c2 = t; }
+        assert_range(ps, r1, r2, c1, c2);
+    }
+    printf("500 random rectangles - PASS\n\n");
+
+    printf("Test 4: Sums beyond 32 bits\n");
+    prefixsum_add(ps, 3, 3, 2147483647);
+    prefixsum_add(ps, 4, 4, 2147483647);
+    // The grid mirror stays unchanged, the difference is the two large values
+    assert(prefixsum_range(ps, 3, 4, 3, 4) - scan_sum(3, 4, 3, 4) == 2 * (int64_t)2147483647);
+    printf("64-bit partial sums - PASS\n\n");
+
+    prefixsum_destroy(ps);
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,215 @@
+// rangeindex.c
+#include "rangeindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper functions
+static int max_rangeindex(int a, int b) {
+    return (a > b) ? a : b;
+}
+
+static int height_node(RangeIndexNode *node) {
+    if (node == NULL)
+        return 0;
+    return node->height;
+}
+
+static int max_r2_node(RangeIndexNode *node) {
+    if (node == NULL)
+        return 0;
+    return node->max_r2;
+}
+
+// Recomputes height and the subtree maximum after a child changed
+static void update_node(RangeIndexNode *node) {
+    node->height = max_rangeindex(height_node(node->left), height_node(node->right)) + 1;
+    node->max_r2 = max_rangeindex(node->r2, max_rangeindex(max_r2_node(node->left), max_r2_node(node->right)));
+}
+
+// Nodes are ordered by start row, ties broken by the owning cell
+static int compare_key(int r1, uint32_t owner, RangeIndexNode *node) {
+    if (r1 != node->r1)
+        return (r1 < node->r1) ? -1 : 1;
+    if (owner != node->owner)
+        return (owner < node->owner) ? -1 : 1;
+    return 0;
+}
+
+static RangeIndexNode* right_rotate(RangeIndexNode *y) {
+    RangeIndexNode *x = y->left;
+    RangeIndexNode *T2 = x->right;
+
+    // Perform rotation
+    x->right = y;
+    y->left = T2;
+
+    // Update heights and maxima, child first
+    update_node(y);
+    update_node(x);
+
+    // Return new root
+    return x;
+}
+
+static RangeIndexNode* left_rotate(RangeIndexNode *x) {
+    RangeIndexNode *y = x->right;
+    RangeIndexNode *T2 = y->left;
+
+    // Perform rotation
+    y->left = x;
+    x->right = T2;
+
+    // Update heights and maxima, child first
+    update_node(x);
+    update_node(y);
+
+    // Return new root
+    return y;
+}
+
+static int get_balance(RangeIndexNode *node) {
+    if (node == NULL)
+        return 0;
+    return height_node(node->left) - height_node(node->right);
+}
+
+static RangeIndexNode* rebalance(RangeIndexNode *node) {
+    update_node(node);
+    int balance = get_balance(node);
+
+    if (balance > 1 && get_balance(node->left) >= 0)
+        return right_rotate(node);
+    if (balance > 1 && get_balance(node->left) < 0) {
+        node->left = left_rotate(node->left);
+        return right_rotate(node);
+    }
+    if (balance < -1 && get_balance(node->right) <= 0)
+        return left_rotate(node);
+    if (balance < -1 && get_balance(node->right) > 0) {
+        node->right = right_rotate(node->right);
+        return left_rotate(node);
+    }
+    return node;
+}
+
+static RangeIndexNode* insert_node(RangeIndexNode *node, RangeIndexNode *new_node, int *inserted) {
+    if (node == NULL) {
+        *inserted = 1;
+        return new_node;
+    }
+
+    int cmp = compare_key(new_node->r1, new_node->owner, node);
+    if (cmp < 0)
+        node->left = insert_node(node->left, new_node, inserted);
+    else if (cmp > 0)
+        node->right = insert_node(node->right, new_node, inserted);
+    else {
+        // Same owner and start row, just replace the rectangle
+        node->r2 = new_node->r2;
+        node->c1 = new_node->c1;
+        node->c2 = new_node->c2;
+    }
+    return rebalance(node);
+}
+
+RangeIndex* rangeindex_create() {
+    RangeIndex *index = malloc(sizeof(RangeIndex));
+    if (!index) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    index->root = NULL;
+    index->size = 0;
+    slab_init(&index->nodes, sizeof(RangeIndexNode), 256);
+    return index;
+}
+
+void rangeindex_insert(RangeIndex *index, uint32_t owner, int r1, int r2, int c1, int c2) {
+    RangeIndexNode *new_node = slab_alloc(&index->nodes);
+    new_node->owner = owner;
+    new_node->r1 = r1;
+    new_node->r2 = r2;
+    new_node->c1 = c1;
+    new_node->c2 = c2;
+    new_node->max_r2 = r2;
+    new_node->height = 1;
+    new_node->left = new_node->right = NULL;
+
+    int inserted = 0;
+    index->root = insert_node(index->root, new_node, &inserted);
+    index->size += inserted;
+    // An existing entry of the owner took the new rectangle
+    if (!inserted)
+        slab_free(&index->nodes, new_node);
+}
+
+static RangeIndexNode* remove_min(RangeIndexNode *node, RangeIndexNode **min) {
+    if (node->left == NULL) {
+        *min = node;
+        return node->right;
+    }
+    node->left = remove_min(node->left, min);
+    return rebalance(node);
+}
+
+static RangeIndexNode* remove_node(SlabPool *nodes, RangeIndexNode *node, uint32_t owner, int r1, int *removed) {
+    if (node == NULL)
+        return NULL;
+
+    int cmp = compare_key(r1, owner, node);
+    if (cmp < 0) {
+        node->left = remove_node(nodes, node->left, owner, r1, removed);
+    } else if (cmp > 0) {
+        node->right = remove_node(nodes, node->right, owner, r1, removed);
+    } else {
+        *removed = 1;
+        RangeIndexNode *left = node->left;
+        RangeIndexNode *right = node->right;
+        slab_free(nodes, node);
+        if (left == NULL)
+            return right;
+        if (right == NULL)
+            return left;
+
+        // Two children: the inorder successor takes this node's place
+        RangeIndexNode *successor = NULL;
+        right = remove_min(right, &successor);
+        successor->left = left;
+        successor->right = right;
+        node = successor;
+    }
+    return rebalance(node);
+}
+
+void rangeindex_remove(RangeIndex *index, uint32_t owner, int r1) {
+    int removed = 0;
+    index->root = remove_node(&index->nodes, index->root, owner, r1, &removed);
+    index->size -= removed;
+}
+
+static void query_node(const RangeIndexNode *node, int row, int col, void (*func)(uint32_t, void*), void *ctx) {
+    // Nothing in this subtree reaches down to row
+    if (node == NULL || node->max_r2 < row)
+        return;
+    query_node(node->left, row, col, func, ctx);
+    // Everything to the right starts below row
+    if (node->r1 > row)
+        return;
+    if (row <= node->r2 && col >= node->c1 && col <= node->c2)
+        func(node->owner, ctx);
+    query_node(node->right, row, col, func, ctx);
+}
+
+// Calls func with the owner of every rectangle that contains (row, col)
+void rangeindex_query(const RangeIndex *index, int row, int col, void (*func)(uint32_t, void*), void *ctx) {
+    query_node(index->root, row, col, func, ctx);
+}
+
+void rangeindex_destroy(RangeIndex *index) {
+    if (index == NULL)
+        return;
+    // Every node lives in the pool's slabs
+    slab_destroy(&index->nodes);
+    free(index);
+}
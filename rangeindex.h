@@ -0,0 +1,35 @@
+// rangeindex.h
+#ifndef RANGEINDEX_H
+#define RANGEINDEX_H
+
+#include <stdint.h>
+#include "slab.h"
+
+// Interval tree of the rectangles read by range formulas (SUM(A1:B9) and friends).
+// Nodes are ordered by (r1, owner) and carry the largest r2 of their subtree, so
+// "which range formulas read this cell" is answered without touching the cells.
+typedef struct RangeIndexNode {
+    uint32_t owner;     // id of the cell holding the range formula
+    int r1;
+    int r2;
+    int c1;
+    int c2;
+    int max_r2;         // largest r2 in this subtree
+    int height;
+    struct RangeIndexNode *left;
+    struct RangeIndexNode *right;
+} RangeIndexNode;
+
+typedef struct RangeIndex {
+    RangeIndexNode *root;
+    int size;
+    SlabPool nodes;     // every node of the tree is carved from here
+} RangeIndex;
+
+RangeIndex* rangeindex_create();
+void rangeindex_insert(RangeIndex *index, uint32_t owner, int r1, int r2, int c1, int c2);
+void rangeindex_remove(RangeIndex *index, uint32_t owner, int r1);
+void rangeindex_query(const RangeIndex *index, int row, int col, void (*func)(uint32_t, void*), void *ctx);
+void rangeindex_destroy(RangeIndex *index);
+
+#endif // RANGEINDEX_H
@@ -0,0 +1,121 @@
+#include "rangeindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+// Collects the owners reported by a query
+typedef struct Hits {
+    uint32_t ids[1024];
+    int count;
+} Hits;
+
+void collect_hit(uint32_t id, void *ctx) {
+    Hits *hits = ctx;
+    hits->ids[hits->count++] = id;
+}
+
+int hit_contains(Hits *hits, uint32_t id) {
+    for (int i = 0; i < hits->count; i++) {
+        if (hits->ids[i] == id)
+            return 1;
+    }
+    return 0;
+}
+
+// Helper function to check the number of rectangles covering a cell
+void assert_hits(RangeIndex *index, int row, int col, int expected) {
+    Hits hits = {{0}, 0};
+    rangeindex_query(index, row, col, collect_hit, &hits);
+    printf("Query (%d,%d): %d hits (Expected: %d) - %s\n",
+           row, col, hits.count, expected,
+           hits.count == expected ? "PASS" : "FAIL");
+    assert(hits.count == expected);
+}
+
+// Checks the subtree maxima and ordering of every node
+int check_node(RangeIndexNode *node) {
+    if (node == NULL)
+        return 0;
+    int max_r2 = node->r2;
+    if (node->left) {
+        assert(node->left->r1 <= node->r1);
+        int left_max = check_node(node->left);
+        if (left_max > max_r2)
+            max_r2 = left_max;
+    }
+    if (node->right) {
+        assert(node->right->r1 >= node->r1);
+        int right_max = check_node(node->right);
+        if (right_max > max_r2)
+            max_r2 = right_max;
+    }
+    assert(node->max_r2 == max_r2);
+    return max_r2;
+}
+
+int main() {
+    printf("=== RangeIndex Test Suite ===\n\n");
+
+    printf("Test 1: Basic creation and insertion\n");
+    RangeIndex *index = rangeindex_create();
+    assert(index != NULL);
+    assert(index->size == 0);
+    assert_hits(index, 1, 1, 0);
+
+    rangeindex_insert(index, 100, 1, 10, 1, 1);    // A1:A10
+    rangeindex_insert(index, 101, 5, 20, 2, 4);    // B5:D20
+    rangeindex_insert(index, 102, 1, 999, 1, 702); // A1:ZZ999
+    assert(index->size == 3);
+    check_node(index->root);
+    printf("\n");
+
+    printf("Test 2: Stabbing queries\n");
+    assert_hits(index, 1, 1, 2);
+    assert_hits(index, 10, 1, 2);
+    assert_hits(index, 11, 1, 1);
+    assert_hits(index, 5, 2, 2);
+    assert_hits(index, 20, 4, 2);
+    assert_hits(index, 21, 4, 1);
+    assert_hits(index, 999, 702, 1);
+    Hits hits = {{0}, 0};
+    rangeindex_query(index, 6, 3, collect_hit, &hits);
+    assert(hit_contains(&hits, 101) && hit_contains(&hits, 102));
+    printf("\n");
+
+    printf("Test 3: Re-inserting an owner replaces its rectangle\n");
+    rangeindex_insert(index, 100, 1, 2, 1, 1);
+    assert(index->size == 3);
+    assert_hits(index, 5, 1, 1);
+    check_node(index->root);
+    printf("\n");
+
+    printf("Test 4: Removal\n");
+    rangeindex_remove(index, 102, 1);
+    assert(index->size == 2);
+    assert_hits(index, 999, 702, 0);
+    assert_hits(index, 1, 1, 1);
+    rangeindex_remove(index, 102, 1); // Missing owners are ignored
+    assert(index->size == 2);
+    printf("\n");
+
+    printf("Test 5: Many overlapping rectangles\n");
+    for (uint32_t i = 0; i < 1000; i++) {
+        int r1 = (int)(i % 50) + 1;
+        rangeindex_insert(index, 1000 + i, r1, r1 + 10, 1, 5);
+    }
+    assert(index->size == 1002);
+    check_node(index->root);
+    // Row 30 is covered by the rectangles starting at rows 20..30, twenty per start row
+    assert_hits(index, 30, 3, 11 * 20);
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        int r1 = (int)(i % 50) + 1;
+        rangeindex_remove(index, 1000 + i, r1);
+    }
+    assert(index->size == 502);
+    check_node(index->root);
+    printf("\n");
+
+    rangeindex_destroy(index);
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,392 @@
+// rangekernels.c
+#include "rangekernels.h"
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RANGEKERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+typedef struct KernelTable {
+    int64_t (*sum)(const int32_t *, int);
+    int32_t (*min)(const int32_t *, int);
+    int32_t (*max)(const int32_t *, int);
+    int (*count_equal)(const int32_t *, int, int32_t);
+    void (*moments)(const int32_t *, int, int64_t *, __int128 *);
+    int (*bits_any)(const uint64_t *, int, int);
+    int (*bits_count)(const uint64_t *, int, int);
+} KernelTable;
+
+/* ------ scalar ------ */
+
+static int64_t sum_scalar(const int32_t *values, int n) {
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+static int32_t min_scalar(const int32_t *values, int n) {
+    int32_t min = values[0];
+    for (int i = 1; i < n; i++)
+        if (values[i] < min)
+            min = values[i];
+    return min;
+}
+
+static int32_t max_scalar(const int32_t *values, int n) {
+    int32_t max = values[0];
+    for (int i = 1; i < n; i++)
+        if (values[i] > max)
+            max = values[i];
+    return max;
+}
+
+static int count_equal_scalar(const int32_t *values, int n, int32_t x) {
+    int count = 0;
+    for (int i = 0; i < n; i++)
+        count += values[i] == x;
+    return count;
+}
+
+static void moments_scalar(const int32_t *values, int n, int64_t *sum, __int128 *sum_squares) {
+    int64_t s = 0;
+    __int128 squares = 0;
+    for (int i = 0; i < n; i++) {
+        s += values[i];
+        squares += (int64_t)values[i] * values[i];
+    }
+    *sum = s;
+    *sum_squares = squares;
+}
+
+// Mask of the bits of word w that lie within first..last
+static uint64_t word_mask(int w, int first, int last) {
+    uint64_t mask = ~(uint64_t)0;
+    if (w == first >> 6)
+        mask &= ~(uint64_t)0 << (first & 63);
+    if (w == last >> 6)
+        mask &= ~(uint64_t)0 >> (63 - (last & 63));
+    return mask;
+}
+
+static int bits_any_scalar(const uint64_t *words, int first, int last) {
+    for (int w = first >> 6; w <= last >> 6; w++)
+        if (words[w] & word_mask(w, first, last))
+            return 1;
+    return 0;
+}
+
+static int bits_count_scalar(const uint64_t *words, int first, int last) {
+    int count = 0;
+    for (int w = first >> 6; w <= last >> 6; w++)
+        count += __builtin_popcountll(words[w] & word_mask(w, first, last));
+    return count;
+}
+
+static const KernelTable scalar_table = {
+    sum_scalar, min_scalar, max_scalar, count_equal_scalar,
+    moments_scalar, bits_any_scalar, bits_count_scalar
+};
+
+#ifdef RANGEKERNELS_X86
+
+/* ------ SSE4.1 ------ */
+
+__attribute__((target("sse4.1")))
+static int64_t sum_sse41(const int32_t *values, int n) {
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    int64_t sum = lanes[0] + lanes[1];
+    for (; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+__attribute__((target("sse4.1")))
+static int32_t min_sse41(const int32_t *values, int n) {
+    if (n < 4)
+        return min_scalar(values, n);
+    __m128i acc = _mm_loadu_si128((const __m128i *)values);
+    int i = 4;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_min_epi32(acc, _mm_loadu_si128((const __m128i *)(values + i)));
+    // The last group overlaps the previous ones, which does not change a minimum
+    acc = _mm_min_epi32(acc, _mm_loadu_si128((const __m128i *)(values + n - 4)));
+    acc = _mm_min_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_min_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("sse4.1")))
+static int32_t max_sse41(const int32_t *values, int n) {
+    if (n < 4)
+        return max_scalar(values, n);
+    __m128i acc = _mm_loadu_si128((const __m128i *)values);
+    int i = 4;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_max_epi32(acc, _mm_loadu_si128((const __m128i *)(values + i)));
+    acc = _mm_max_epi32(acc, _mm_loadu_si128((const __m128i *)(values + n - 4)));
+    acc = _mm_max_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_max_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("sse4.1")))
+static int count_equal_sse41(const int32_t *values, int n, int32_t x) {
+    __m128i target = _mm_set1_epi32(x);
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+    // Matching lanes compare to -1, so subtracting them counts
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i)), target));
+    int count = _mm_extract_epi32(acc, 0) + _mm_extract_epi32(acc, 1) +
+                _mm_extract_epi32(acc, 2) + _mm_extract_epi32(acc, 3);
+    for (; i < n; i++)
+        count += values[i] == x;
+    return count;
+}
+
+// A square is below 2^62, too wide to add up in 64-bit lanes. Its low and high 32 bits
+// are summed apart instead, neither can overflow for fewer than 2^31 values
+__attribute__((target("sse4.1")))
+static void moments_sse41(const int32_t *values, int n, int64_t *sum, __int128 *sum_squares) {
+    __m128i low_mask = _mm_set1_epi64x(0xffffffff);
+    __m128i acc = _mm_setzero_si128(), lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+        __m128i odd = _mm_srli_epi64(v, 32);
+        __m128i even_sq = _mm_mul_epi32(v, v);
+        __m128i odd_sq = _mm_mul_epi32(odd, odd);
+        lo = _mm_add_epi64(lo, _mm_add_epi64(_mm_and_si128(even_sq, low_mask), _mm_and_si128(odd_sq, low_mask)));
+        hi = _mm_add_epi64(hi, _mm_add_epi64(_mm_srli_epi64(even_sq, 32), _mm_srli_epi64(odd_sq, 32)));
+    }
+    int64_t sum_lanes[2];
+    uint64_t lo_lanes[2], hi_lanes[2];
+    _mm_storeu_si128((__m128i *)sum_lanes, acc);
+    _mm_storeu_si128((__m128i *)lo_lanes, lo);
+    _mm_storeu_si128((__m128i *)hi_lanes, hi);
+    moments_scalar(values + i, n - i, sum, sum_squares);
+    *sum += sum_lanes[0] + sum_lanes[1];
+    *sum_squares += ((__int128)(hi_lanes[0] + hi_lanes[1]) << 32) + lo_lanes[0] + lo_lanes[1];
+}
+
+static const KernelTable sse41_table = {
+    sum_sse41, min_sse41, max_sse41, count_equal_sse41,
+    moments_sse41, bits_any_scalar, bits_count_scalar
+};
+
+/* ------ AVX2 ------ */
+
+__attribute__((target("avx2")))
+static int64_t sum_avx2(const int32_t *values, int n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static int32_t min_avx2(const int32_t *values, int n) {
+    if (n < 8)
+        return min_scalar(values, n);
+    __m256i acc = _mm256_loadu_si256((const __m256i *)values);
+    int i = 8;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i *)(values + i)));
+    acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i *)(values + n - 8)));
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("avx2")))
+static int32_t max_avx2(const int32_t *values, int n) {
+    if (n < 8)
+        return max_scalar(values, n);
+    __m256i acc = _mm256_loadu_si256((const __m256i *)values);
+    int i = 8;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i *)(values + i)));
+    acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i *)(values + n - 8)));
+    __m128i half = _mm_max_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("avx2")))
+static int count_equal_avx2(const int32_t *values, int n, int32_t x) {
+    __m256i target = _mm256_set1_epi32(x);
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i)), target));
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int count = 0;
+    for (int l = 0; l < 8; l++)
+        count += lanes[l];
+    for (; i < n; i++)
+        count += values[i] == x;
+    return count;
+}
+
+__attribute__((target("avx2")))
+static void moments_avx2(const int32_t *values, int n, int64_t *sum, __int128 *sum_squares) {
+    __m256i low_mask = _mm256_set1_epi64x(0xffffffff);
+    __m256i acc = _mm256_setzero_si256(), lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        __m256i odd = _mm256_srli_epi64(v, 32);
+        __m256i even_sq = _mm256_mul_epi32(v, v);
+        __m256i odd_sq = _mm256_mul_epi32(odd, odd);
+        lo = _mm256_add_epi64(lo, _mm256_add_epi64(_mm256_and_si256(even_sq, low_mask), _mm256_and_si256(odd_sq, low_mask)));
+        hi = _mm256_add_epi64(hi, _mm256_add_epi64(_mm256_srli_epi64(even_sq, 32), _mm256_srli_epi64(odd_sq, 32)));
+    }
+    int64_t sum_lanes[4];
+    uint64_t lo_lanes[4], hi_lanes[4];
+    _mm256_storeu_si256((__m256i *)sum_lanes, acc);
+    _mm256_storeu_si256((__m256i *)lo_lanes, lo);
+    _mm256_storeu_si256((__m256i *)hi_lanes, hi);
+    moments_scalar(values + i, n - i, sum, sum_squares);
+    *sum += sum_lanes[0] + sum_lanes[1] + sum_lanes[2] + sum_lanes[3];
+    *sum_squares += ((__int128)(hi_lanes[0] + hi_lanes[1] + hi_lanes[2] + hi_lanes[3]) << 32) +
+                    lo_lanes[0] + lo_lanes[1] + lo_lanes[2] + lo_lanes[3];
+}
+
+// Only the partial words at either end need masking, the words between are tested four at a time
+__attribute__((target("avx2")))
+static int bits_any_avx2(const uint64_t *words, int first, int last) {
+    int w = first >> 6, w_last = last >> 6;
+    if (words[w] & word_mask(w, first, last))
+        return 1;
+    if (w == w_last)
+        return 0;
+    for (w++; w + 4 <= w_last; w += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(words + w));
+        if (!_mm256_testz_si256(v, v))
+            return 1;
+    }
+    for (; w < w_last; w++)
+        if (words[w])
+            return 1;
+    return (words[w_last] & word_mask(w_last, first, last)) != 0;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int bits_count_avx2(const uint64_t *words, int first, int last) {
+    int w = first >> 6, w_last = last >> 6;
+    int count = __builtin_popcountll(words[w] & word_mask(w, first, last));
+    if (w == w_last)
+        return count;
+    for (w++; w < w_last; w++)
+        count += __builtin_popcountll(words[w]);
+    return count + __builtin_popcountll(words[w_last] & word_mask(w_last, first, last));
+}
+
+static const KernelTable avx2_table = {
+    sum_avx2, min_avx2, max_avx2, count_equal_avx2,
+    moments_avx2, bits_any_avx2, bits_count_avx2
+};
+
+#endif // RANGEKERNELS_X86
+
+/* ------ dispatch ------ */
+
+static const KernelTable *active = NULL;
+static KernelLevel active_level = KERNEL_SCALAR;
+
+KernelLevel kernels_select(KernelLevel max_level) {
+    KernelLevel level = KERNEL_SCALAR;
+    const KernelTable *table = &scalar_table;
+#ifdef RANGEKERNELS_X86
+    __builtin_cpu_init();
+    if (max_level >= KERNEL_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        level = KERNEL_AVX2;
+        table = &avx2_table;
+    } else if (max_level >= KERNEL_SSE41 && __builtin_cpu_supports("sse4.1")) {
+        level = KERNEL_SSE41;
+        table = &sse41_table;
+    }
+#else
+    (void)max_level;
+#endif
+    active = table;
+    active_level = level;
+    return level;
+}
+
+static const KernelTable *kernels(void) {
+    if (active == NULL)
+        kernels_select(KERNEL_AVX2);
+    return active;
+}
+
+KernelLevel kernels_level(void) {
+    kernels();
+    return active_level;
+}
+
+const char* kernels_level_name(KernelLevel level) {
+    switch (level) {
+    case KERNEL_AVX2:
+        return "avx2";
+    case KERNEL_SSE41:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
+
+int64_t kernel_sum(const int32_t *values, int n) {
+    return kernels()->sum(values, n);
+}
+
+int32_t kernel_min(const int32_t *values, int n) {
+    return kernels()->min(values, n);
+}
+
+int32_t kernel_max(const int32_t *values, int n) {
+    return kernels()->max(values, n);
+}
+
+int kernel_count_equal(const int32_t *values, int n, int32_t x) {
+    return kernels()->count_equal(values, n, x);
+}
+
+void kernel_moments(const int32_t *values, int n, int64_t *sum, __int128 *sum_squares) {
+    kernels()->moments(values, n, sum, sum_squares);
+}
+
+int kernel_bits_any(const uint64_t *words, int first, int last) {
+    return kernels()->bits_any(words, first, last);
+}
+
+int kernel_bits_count(const uint64_t *words, int first, int last) {
+    return kernels()->bits_count(words, first, last);
+}
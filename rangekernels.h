@@ -0,0 +1,33 @@
+// rangekernels.h
+#ifndef RANGEKERNELS_H
+#define RANGEKERNELS_H
+
+#include <stdint.h>
+
+// Reduction kernels over a contiguous run of cell values or error bits. Each kernel
+// has a scalar version and, on x86, SSE4.1 and AVX2 versions picked at runtime from
+// what the CPU supports. All versions give identical results.
+typedef enum KernelLevel {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE41,
+    KERNEL_AVX2
+} KernelLevel;
+
+// Selects the best level the CPU supports that is not above max_level and returns it
+KernelLevel kernels_select(KernelLevel max_level);
+KernelLevel kernels_level(void);
+const char* kernels_level_name(KernelLevel level);
+
+int64_t kernel_sum(const int32_t *values, int n);
+// n must be at least 1
+int32_t kernel_min(const int32_t *values, int n);
+int32_t kernel_max(const int32_t *values, int n);
+int kernel_count_equal(const int32_t *values, int n, int32_t x);
+// Sum and exact sum of squares in one pass, 128 bits hold the squares of any range of the grid
+void kernel_moments(const int32_t *values, int n, int64_t *sum, __int128 *sum_squares);
+
+// Bits first..last (inclusive) of a bitmap
+int kernel_bits_any(const uint64_t *words, int first, int last);
+int kernel_bits_count(const uint64_t *words, int first, int last);
+
+#endif // RANGEKERNELS_H
@@ -0,0 +1,114 @@
+#include "rangekernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define LENGTH 300
+#define WORDS 16
+
+int32_t values[LENGTH];
+uint64_t bits[WORDS];
+
+// Reference results computed directly
+int64_t ref_sum(const int32_t *v, int n) {
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += v[i];
+    return sum;
+}
+
+int ref_bits_count(int first, int last) {
+    int count = 0;
+    for (int b = first; b <= last; b++)
+        count += (bits[b >> 6] >> (b & 63)) & 1;
+    return count;
+}
+
+// Checks every kernel of the selected level over every start and length up to n
+void check_level(int max_start, int n) {
+    for (int start = 0; start < max_start; start++) {
+        for (int len = 1; start + len <= n; len++) {
+            const int32_t *v = values + start;
+            int32_t min = v[0], max = v[0];
+            for (int i = 1; i < len; i++) {
+                if (v[i] < min) min = v[i];
+                if (v[i] > max) max = v[i];
+            }
+            assert(kernel_sum(v, len) == ref_sum(v, len));
+            assert(kernel_min(v, len) == min);
+            assert(kernel_max(v, len) == max);
+            int count = 0;
+            for (int i = 0; i < len; i++)
+                count += v[i] == max;
+            assert(kernel_count_equal(v, len, max) == count);
+        }
+    }
+    for (int first = 0; first < WORDS * 64; first += 13)
+        for (int last = first; last < WORDS * 64; last += 7) {
+            assert(kernel_bits_count(bits, first, last) == ref_bits_count(first, last));
+            assert(kernel_bits_any(bits, first, last) == (ref_bits_count(first, last) > 0));
+        }
+}
+
+int main() {
+    printf("=== Range Kernels Test Suite ===\n\n");
+    srand(11);
+    for (int i = 0; i < LENGTH; i++)
+        values[i] = rand() % 2001 - 1000;
+
+    KernelLevel best = kernels_select(KERNEL_AVX2);
+    printf("Best level on this CPU: %s\n\n", kernels_level_name(best));
+
+    printf("Test 1: Every level against direct loops\n");
+    for (int level = KERNEL_SCALAR; level <= (int)best; level++) {
+        assert(kernels_select((KernelLevel)level) == (KernelLevel)level);
+        assert(kernels_level() == (KernelLevel)level);
+        for (int w = 0; w < WORDS; w++)
+            bits[w] = 0;
+        check_level(9, LENGTH);
+        bits[3] = (uint64_t)1 << 17;
+        bits[WORDS - 1] = (uint64_t)1 << 63;
+        check_level(1, 40);
+        for (int w = 0; w < WORDS; w++)
+            bits[w] = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+        check_level(1, 40);
+        printf("%s - PASS\n", kernels_level_name((KernelLevel)level));
+    }
+    printf("\n");
+
+    printf("Test 2: Extreme values\n");
+    for (int level = KERNEL_SCALAR; level <= (int)best; level++) {
+        kernels_select((KernelLevel)level);
+        int32_t extreme[19];
+        for (int i = 0; i < 19; i++)
+            extreme[i] = (i & 1) ? INT32_MAX : INT32_MIN;
+        assert(kernel_min(extreme, 19) == INT32_MIN);
+        assert(kernel_max(extreme + 1, 18) == INT32_MAX);
+        assert(kernel_sum(extreme, 19) == 9 * (int64_t)INT32_MAX + 10 * (int64_t)INT32_MIN);
+        assert(kernel_count_equal(extreme, 19, INT32_MIN) == 10);
+    }
+    printf("Sums do not overflow and extremes survive - PASS\n\n");
+
+    printf("Test 3: Sum and sum of squares are exact on every level\n");
+    for (int i = 0; i < LENGTH; i++)
+        values[i] = (i % 3 == 0) ? INT32_MIN + rand() % 3 : rand() % 2001 - 1000;
+    for (int level = KERNEL_SCALAR; level <= (int)best; level++) {
+        kernels_select((KernelLevel)level);
+        for (int start = 0; start < 9; start++) {
+            int64_t expected_sum = 0;
+            __int128 expected = 0;
+            for (int len = 1; start + len <= LENGTH; len++) {
+                int64_t sum;
+                __int128 sum_squares;
+                expected_sum += values[start + len - 1];
+                expected += (int64_t)values[start + len - 1] * values[start + len - 1];
+                kernel_moments(values + start, len, &sum, &sum_squares);
+                assert(sum == expected_sum && sum_squares == expected);
+            }
+        }
+    }
+    printf("Squares of INT32_MIN add up without overflow - PASS\n\n");
+
+    printf("All range kernel tests passed!\n");
+    return 0;
+}
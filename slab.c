@@ -0,0 +1,65 @@
+// slab.c
+#include "slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Objects and the slab header are kept on this boundary, enough for __int128 members
+#define SLAB_ALIGN 16
+
+static inline size_t align_up(size_t size) {
+    return (size + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+}
+
+void slab_init(SlabPool *pool, size_t object_size, size_t per_slab) {
+    if (object_size < sizeof(void *))
+        object_size = sizeof(void *);
+    pool->object_size = align_up(object_size);
+    pool->per_slab = per_slab ? per_slab : 1;
+    pool->slabs = NULL;
+    pool->bump = NULL;
+    pool->bump_end = NULL;
+    pool->free_list = NULL;
+    pool->live = 0;
+}
+
+void* slab_alloc(SlabPool *pool) {
+    void *object;
+    if (pool->free_list != NULL) {
+        object = pool->free_list;
+        pool->free_list = *(void **)object;
+    } else {
+        if (pool->bump == pool->bump_end) {
+            char *slab = malloc(align_up(sizeof(void *)) + pool->per_slab * pool->object_size);
+            if (!slab) {
+                perror("Failed to allocate memory");
+                exit(EXIT_FAILURE);
+            }
+            *(void **)slab = pool->slabs;
+            pool->slabs = slab;
+            pool->bump = slab + align_up(sizeof(void *));
+            pool->bump_end = pool->bump + pool->per_slab * pool->object_size;
+        }
+        object = pool->bump;
+        pool->bump += pool->object_size;
+    }
+    pool->live++;
+    return object;
+}
+
+void slab_free(SlabPool *pool, void *object) {
+    if (object == NULL)
+        return;
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pool->live--;
+}
+
+void slab_destroy(SlabPool *pool) {
+    while (pool->slabs != NULL) {
+        void *previous = *(void **)pool->slabs;
+        free(pool->slabs);
+        pool->slabs = previous;
+    }
+    slab_init(pool, pool->object_size, pool->per_slab);
+}
@@ -0,0 +1,26 @@
+// slab.h
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+// Pool of equally sized objects carved out of large slabs. Allocation pops the free
+// list or bumps a pointer through the newest slab, release pushes the object back on
+// the free list, and destroying the pool frees the slabs rather than every object.
+typedef struct SlabPool {
+    size_t object_size;     // rounded up so every object is aligned and can hold a free-list link
+    size_t per_slab;        // objects carved out of each slab
+    void *slabs;            // newest slab, each one links to the previous through its header
+    char *bump;             // next never used object of the newest slab
+    char *bump_end;
+    void *free_list;        // released objects, linked through their first bytes
+    size_t live;            // objects handed out and not yet released
+} SlabPool;
+
+void slab_init(SlabPool *pool, size_t object_size, size_t per_slab);
+void* slab_alloc(SlabPool *pool);
+void slab_free(SlabPool *pool, void *object);
+// Frees every slab, objects still handed out go with them. The pool can be used again
+void slab_destroy(SlabPool *pool);
+
+#endif // SLAB_H
@@ -0,0 +1,64 @@
+#include "slab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define OBJECTS 5000
+
+typedef struct Wide {
+    __int128 total;
+    int tag;
+} Wide;
+
+int main() {
+    printf("=== Slab Test Suite ===\n\n");
+
+    printf("Test 1: Objects are aligned, distinct and writable\n");
+    SlabPool pool;
+    slab_init(&pool, sizeof(Wide), 64);
+    assert(pool.object_size % 16 == 0 && pool.object_size >= sizeof(Wide));
+    Wide *objects[OBJECTS];
+    for (int i = 0; i < OBJECTS; i++) {
+        objects[i] = slab_alloc(&pool);
+        assert(((uintptr_t)objects[i] & 15) == 0);
+        objects[i]->total = (__int128)i << 70;
+        objects[i]->tag = i;
+    }
+    for (int i = 0; i < OBJECTS; i++)
+        assert(objects[i]->tag == i && objects[i]->total == (__int128)i << 70);
+    assert(pool.live == OBJECTS);
+    printf("%d objects over %d-object slabs - PASS\n\n", OBJECTS, 64);
+
+    printf("Test 2: Released objects are handed out again first\n");
+    slab_free(&pool, objects[10]);
+    slab_free(&pool, objects[20]);
+    slab_free(&pool, NULL);
+    assert(pool.live == OBJECTS - 2);
+    char *bump = pool.bump;
+    assert(slab_alloc(&pool) == objects[20]);
+    assert(slab_alloc(&pool) == objects[10]);
+    assert(pool.bump == bump && pool.live == OBJECTS);
+    printf("Free list is last in, first out - PASS\n\n");
+
+    printf("Test 3: Destroying drops every slab and the pool starts over\n");
+    slab_destroy(&pool);
+    assert(pool.slabs == NULL && pool.free_list == NULL && pool.live == 0);
+    char *small = slab_alloc(&pool);
+    strcpy(small, "A1+1");
+    assert(pool.slabs != NULL && pool.live == 1);
+    slab_destroy(&pool);
+
+    // Tiny objects still hold a free-list link
+    slab_init(&pool, 1, 8);
+    assert(pool.object_size >= sizeof(void *));
+    void *a = slab_alloc(&pool);
+    slab_free(&pool, a);
+    assert(slab_alloc(&pool) == a);
+    slab_destroy(&pool);
+    printf("Reuse after destroy - PASS\n\n");
+
+    printf("All slab tests passed!\n");
+    return 0;
+}
@@ -1,10 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
-#define STACK_SIZE 2048
-#include "stack.h"
-#include "linked_list.h"
 #include "spreadsheet.h"
 #include "cell.h"
-#include "orderedset.h"
+#include "rangekernels.h"
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,7 +11,6 @@
 #include <math.h>
 #include <time.h>
 #include <unistd.h>
-#include <regex.h>
 
 // Helper for safer string copy
 void safe_strcpy(char *dest, size_t dest_size, const char *src)
@@ -32,61 +28,446 @@ Spreadsheet *spreadsheet_create(int rows, int cols)
 {
     // fprintf(stderr, "[DEBUG] Creating spreadsheet: %d rows, %d cols\n", rows, cols);
     Spreadsheet *sheet = (Spreadsheet *)malloc(sizeof(Spreadsheet));
+    if (sheet == NULL)
+    {
+        fprintf(stderr, "Space exceeded\n");
+        return NULL;
+    }
     sheet->rows = rows;
     sheet->cols = cols;
     sheet->view_row = 0;
     sheet->view_col = 0;
-    sheet->cells = (Cell **)malloc(rows * cols * (sizeof(Cell *)));
-    if (sheet->cells == NULL)
-    {
+
+    // Only the page directory is allocated up front, cells are created on first use
+    sheet->page_rows = (rows + SHEET_PAGE_ROWS - 1) / SHEET_PAGE_ROWS;
+    sheet->page_cols = (cols + SHEET_PAGE_COLS - 1) / SHEET_PAGE_COLS;
+    sheet->pages = (Cell ***)calloc((size_t)sheet->page_rows * sheet->page_cols, sizeof(Cell **));
+    // Cells and aggregates come from sheet-wide pools that are freed slab by slab
+    slab_init(&sheet->cell_pool, sizeof(Cell), 1024);
+    slab_init(&sheet->aggregate_pool, sizeof(RangeAggregate), 256);
+    sheet->templates = templatetable_create();
+
+    // Values and error flags are dense columnar arrays indexed by cell id. calloc hands back
+    // untouched zero pages, so memory is only committed for the parts of the grid in use
+    size_t cell_count = (size_t)rows * cols;
+    sheet->values = (int32_t *)calloc(cell_count, sizeof(int32_t));
+    sheet->errors = (uint64_t *)calloc((cell_count + 63) / 64, sizeof(uint64_t));
+    sheet->marks = (uint32_t *)calloc(cell_count, sizeof(uint32_t));
+    sheet->ranks = (int32_t *)calloc(cell_count, sizeof(int32_t));
+    sheet->rank_tree = NULL;
+    sheet->epoch = 0;
+    sheet->stack = NULL;
+    sheet->order = NULL;
+    sheet->queue = NULL;
+    sheet->results = NULL;
+    sheet->walk_capacity = 0;
+    sheet->pool = NULL;
+    sheet->stats = (RecalcStats){0, 0, 0};
+    sheet->dirty = NULL;
+    sheet->manual = 0;
+    sheet->pending = NULL;
+    sheet->pending_count = 0;
+    sheet->pending_capacity = 0;
+    sheet->frozen = NULL;
+    sheet->graph_edits = 0;
+    sheet->ranges = rangeindex_create();
+    sheet->prefix = NULL;
+    sheet->minmax = NULL;
+    if (sheet->pages == NULL || sheet->values == NULL || sheet->errors == NULL || sheet->marks == NULL ||
+        sheet->ranks == NULL)
+    {
+        rangeindex_destroy(sheet->ranges);
+        free(sheet->pages);
+        free(sheet->values);
+        free(sheet->errors);
+        free(sheet->marks);
+        free(sheet->ranks);
         free(sheet);
         fprintf(stderr, "Space exceeded\n");
+        return NULL;
+    }
+    return sheet;
+}
+
+void destroySpreadsheet(Spreadsheet *sheet)
+{
+    int page_count = sheet->page_rows * sheet->page_cols;
+    for (int p = 0; p < page_count; p++)
+    {
+        Cell **page = sheet->pages[p];
+        if (page == NULL)
+            continue;
+        // The cells themselves go with their pools, only what they hold outside them is freed
+        for (int i = 0; i < SHEET_PAGE_ROWS * SHEET_PAGE_COLS; i++)
+        {
+            if (page[i])
+                depset_free(&page[i]->dependents);
+        }
+        free(page);
+    }
+    free(sheet->pages);
+    slab_destroy(&sheet->cell_pool);
+    slab_destroy(&sheet->aggregate_pool);
+    templatetable_destroy(sheet->templates);
+    free(sheet->values);
+    free(sheet->errors);
+    free(sheet->marks);
+    free(sheet->ranks);
+    minmaxtree_destroy(sheet->rank_tree);
+    free(sheet->stack);
+    free(sheet->order);
+    free(sheet->queue);
+    free(sheet->results);
+    free(sheet->dirty);
+    free(sheet->pending);
+    csrgraph_destroy(sheet->frozen);
+    threadpool_destroy(sheet->pool);
+    rangeindex_destroy(sheet->ranges);
+    prefixsum_destroy(sheet->prefix);
+    minmaxtree_destroy(sheet->minmax);
+    free(sheet);
+}
+
+/* Maintains 2D prefix sums of the values from now on, so SUM and AVG over any rectangle
+   are four lookups. Costs 8 bytes per cell, returns 0 if that cannot be allocated */
+int spreadsheet_enable_prefix_sums(Spreadsheet *sheet)
+{
+    if (sheet->prefix != NULL)
+        return 1;
+    sheet->prefix = prefixsum_create(sheet->rows, sheet->cols);
+    if (sheet->prefix == NULL)
+        return 0;
+    for (int r = 1; r <= sheet->rows; r++)
+    {
+        for (int c = 1; c <= sheet->cols; c++)
+        {
+            int value = spreadsheet_get_value(sheet, r, c);
+            if (value != 0)
+                prefixsum_add(sheet->prefix, r, c, value);
+        }
+    }
+    return 1;
+}
+
+/* Evaluates large recalculations on the given number of threads from now on, 1 turns
+   it back to the calling thread alone */
+void spreadsheet_set_threads(Spreadsheet *sheet, int threads)
+{
+    threadpool_destroy(sheet->pool);
+    sheet->pool = NULL;
+    if (threads > 1)
+    {
+        // Settle the kernel dispatch before any worker can race to do it
+        kernels_level();
+        sheet->pool = threadpool_create(threads);
+    }
+}
+
+/* ----------------
+   Cell Access
+   ---------------- */
+
+// Shared stand-in for every cell that was never written or referenced
+static const Cell empty_cell = {.frozen = CELL_NOT_FROZEN};
+
+static Cell **spreadsheet_cell_slot(const Spreadsheet *sheet, int row, int col, int create)
+{
+    int page_index = ((row - 1) / SHEET_PAGE_ROWS) * sheet->page_cols + (col - 1) / SHEET_PAGE_COLS;
+    Cell **page = sheet->pages[page_index];
+    if (page == NULL)
+    {
+        if (!create)
+            return NULL;
+        page = (Cell **)calloc(SHEET_PAGE_ROWS * SHEET_PAGE_COLS, sizeof(Cell *));
+        if (page == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for page of cell (%d, %d)\n", row, col);
+            exit(EXIT_FAILURE);
+        }
+        sheet->pages[page_index] = page;
+    }
+    return &page[((row - 1) % SHEET_PAGE_ROWS) * SHEET_PAGE_COLS + (col - 1) % SHEET_PAGE_COLS];
+}
+
+/* Returns the cell at (row, col), materialising it on first use */
+Cell *spreadsheet_get_cell(Spreadsheet *sheet, int row, int col)
+{
+    Cell **slot = spreadsheet_cell_slot(sheet, row, col, 1);
+    if (*slot == NULL)
+    {
+        *slot = (Cell *)slab_alloc(&sheet->cell_pool);
+        cell_init(*slot, row, col);
+    }
+    return *slot;
+}
+
+/* Returns the cell at (row, col) or NULL if it was never materialised */
+Cell *spreadsheet_find_cell(const Spreadsheet *sheet, int row, int col)
+{
+    Cell **slot = spreadsheet_cell_slot(sheet, row, col, 0);
+    return slot ? *slot : NULL;
+}
+
+Cell *spreadsheet_get_cell_by_id(Spreadsheet *sheet, uint32_t id)
+{
+    return spreadsheet_get_cell(sheet, id / sheet->cols + 1, id % sheet->cols + 1);
+}
+
+/* Read-only view of the cell at (row, col), never-used cells read as an empty zero cell */
+const Cell *spreadsheet_peek_cell(const Spreadsheet *sheet, int row, int col)
+{
+    const Cell *cell = spreadsheet_find_cell(sheet, row, col);
+    return cell ? cell : &empty_cell;
+}
+
+/* Splits the rectangle into runs of consecutive cell ids, one per row, or a single
+   run when it spans whole rows. Returns the number of runs, they start sheet->cols apart */
+static inline int range_runs(const Spreadsheet *sheet, int r1, int r2, int c1, int c2, int *length)
+{
+    if (c1 == 1 && c2 == sheet->cols)
+    {
+        *length = (r2 - r1 + 1) * sheet->cols;
+        return 1;
+    }
+    *length = c2 - c1 + 1;
+    return r2 - r1 + 1;
+}
+
+/* Checks whether any cell in the rectangle has its error bit set */
+int spreadsheet_range_has_error(const Spreadsheet *sheet, int r1, int r2, int c1, int c2)
+{
+    int length;
+    int runs = range_runs(sheet, r1, r2, c1, c2, &length);
+    int first = spreadsheet_cell_id(sheet, r1, c1);
+    for (int i = 0; i < runs; i++, first += sheet->cols)
+    {
+        if (kernel_bits_any(sheet->errors, first, first + length - 1))
+            return 1;
     }
+    return 0;
+}
+
+/* ----------------
+   Range Aggregates
+   ---------------- */
+
+static inline int extremum_better(int op, int a, int b)
+{
+    return (op == FORMULA_MIN) ? a < b : a > b;
+}
+
+/* Counts the cells of the rectangle that have their error bit set */
+int spreadsheet_range_error_count(const Spreadsheet *sheet, int r1, int r2, int c1, int c2)
+{
+    int length;
+    int runs = range_runs(sheet, r1, r2, c1, c2, &length);
+    int first = spreadsheet_cell_id(sheet, r1, c1);
+    int count = 0;
+    for (int i = 0; i < runs; i++, first += sheet->cols)
+        count += kernel_bits_count(sheet->errors, first, first + length - 1);
+    return count;
+}
 
-    // Initialize cells
-    for (int r = 1; r <= rows; r++)
+/* Rescans the range of a MIN/MAX formula for its extremum and how many cells hold it */
+static void aggregate_rescan_extremum(const Spreadsheet *sheet, const Formula *formula, RangeAggregate *aggregate)
+{
+    if (sheet->minmax != NULL)
+    {
+        // The tree gives the extremum but not its multiplicity. Counting one holder never
+        // overstates it, so the extremum is at worst queried again a little early
+        int min, max;
+        minmaxtree_query(sheet->minmax, formula->r1, formula->r2, formula->c1, formula->c2, &min, &max);
+        aggregate->extremum = (formula->op == FORMULA_MIN) ? min : max;
+        aggregate->extremum_count = 1;
+        return;
+    }
+    int length;
+    int runs = range_runs(sheet, formula->r1, formula->r2, formula->c1, formula->c2, &length);
+    const int32_t *run = sheet->values + spreadsheet_cell_id(sheet, formula->r1, formula->c1);
+    int extremum = run[0];
+    int count = 0;
+    for (int i = 0; i < runs; i++, run += sheet->cols)
     {
-        for (int c = 1; c <= cols; c++)
+        int best = (formula->op == FORMULA_MIN) ? kernel_min(run, length) : kernel_max(run, length);
+        if (extremum_better(formula->op, best, extremum))
         {
-            sheet->cells[cols * (r - 1) + (c - 1)] = cell_create(r, c);
-            // fprintf(stderr, "Created cell (%d, %d)\n", r, c);
+            extremum = best;
+            count = 0;
+        }
+        if (best == extremum)
+            count += kernel_count_equal(run, length, extremum);
+    }
+    aggregate->extremum = extremum;
+    aggregate->extremum_count = count;
+}
 
-            if (!sheet->cells[cols * (r - 1) + (c - 1)]) // Check if allocation failed
+/* Builds the aggregate of a range formula from scratch, done once when it is assigned */
+static void aggregate_build(const Spreadsheet *sheet, const Formula *formula, RangeAggregate *aggregate)
+{
+    int64_t sum = 0;
+    __int128 sum_squares = 0;
+    if (formula->op == FORMULA_MIN || formula->op == FORMULA_MAX)
+    {
+        // MIN and MAX never read the sums
+    }
+    else if (sheet->prefix != NULL && formula->op != FORMULA_STDEV)
+    {
+        sum = prefixsum_range(sheet->prefix, formula->r1, formula->r2, formula->c1, formula->c2);
+    }
+    else
+    {
+        int length;
+        int runs = range_runs(sheet, formula->r1, formula->r2, formula->c1, formula->c2, &length);
+        const int32_t *run = sheet->values + spreadsheet_cell_id(sheet, formula->r1, formula->c1);
+        for (int i = 0; i < runs; i++, run += sheet->cols)
+        {
+            if (formula->op == FORMULA_STDEV)
+            {
+                // Both sums in the same pass over the run
+                int64_t run_sum;
+                __int128 run_squares;
+                kernel_moments(run, length, &run_sum, &run_squares);
+                sum += run_sum;
+                sum_squares += run_squares;
+            }
+            else
             {
-                fprintf(stderr, "Memory allocation failed for cell (%d, %d)\n", r, c);
-
-                // Free already allocated cells before exiting
-                for (int rr = 1; rr <= r; rr++)
-                {
-                    for (int cc = 1; cc <= cols; cc++)
-                    {
-                        if (sheet->cells[cols * (rr - 1) + (cc - 1)])
-                            cell_destroy(sheet->cells[cols * (rr - 1) + (cc - 1)]);
-                    }
-                }
-                free(sheet->cells);
-                free(sheet);
-                return NULL;
+                sum += kernel_sum(run, length);
             }
+        }
+    }
+    aggregate->sum = sum;
+    aggregate->sum_squares = sum_squares;
+    aggregate->error_count = spreadsheet_range_error_count(sheet, formula->r1, formula->r2, formula->c1, formula->c2);
+    aggregate->extremum = 0;
+    aggregate->extremum_count = 0;
+    if (formula->op == FORMULA_MIN || formula->op == FORMULA_MAX)
+        aggregate_rescan_extremum(sheet, formula, aggregate);
+}
+
+/* Old and new contents of a cell that was just stored */
+typedef struct ValueDelta
+{
+    const Spreadsheet *sheet;
+    int old_value;
+    int new_value;
+    int error_change;
+} ValueDelta;
+
+/* Folds one store into the aggregate of a range formula that covers the cell */
+static void apply_value_delta(uint32_t owner, void *ctx)
+{
+    ValueDelta *delta = (ValueDelta *)ctx;
+    const Spreadsheet *sheet = delta->sheet;
+    Cell *cell = spreadsheet_find_cell(sheet, owner / sheet->cols + 1, owner % sheet->cols + 1);
+    RangeAggregate *aggregate = cell ? cell->aggregate : NULL;
+    if (aggregate == NULL)
+        return;
+    aggregate->sum += (int64_t)delta->new_value - delta->old_value;
+    aggregate->sum_squares += (int64_t)delta->new_value * delta->new_value - (int64_t)delta->old_value * delta->old_value;
+    aggregate->error_count += delta->error_change;
 
+    int op = templatetable_shape(sheet->templates, cell->shape)->op;
+    if (op != FORMULA_MIN && op != FORMULA_MAX)
+        return;
+    if (aggregate->extremum_count > 0 && delta->old_value == aggregate->extremum)
+        aggregate->extremum_count--;
+    if (aggregate->extremum_count == 0)
+    {
+        // Every other cell is strictly worse than the last extremum, so only a value
+        // at least as good settles it without a rescan
+        if (!extremum_better(op, aggregate->extremum, delta->new_value))
+        {
+            aggregate->extremum = delta->new_value;
+            aggregate->extremum_count = 1;
         }
     }
-    return sheet;
+    else if (extremum_better(op, delta->new_value, aggregate->extremum))
+    {
+        aggregate->extremum = delta->new_value;
+        aggregate->extremum_count = 1;
+    }
+    else if (delta->new_value == aggregate->extremum)
+    {
+        aggregate->extremum_count++;
+    }
 }
 
-void destroySpreadsheet(Spreadsheet *sheet)
+/* Evaluates a range formula from its aggregate without reading the range */
+static int evaluate_range(const Spreadsheet *sheet, const Formula *formula, RangeAggregate *aggregate, char *error)
 {
-    int col = sheet->cols;
-    for (int r = 1; r <= sheet->rows; r++)
+    if (aggregate->error_count > 0)
     {
-        for (int c = 1; c <= sheet->cols; c++)
+        *error = 1;
+        return 0;
+    }
+    int r1 = formula->r1, r2 = formula->r2, c1 = formula->c1, c2 = formula->c2;
+    int count = (r2 - r1 + 1) * (c2 - c1 + 1);
+    // The int sum of the range wraps the same way the 64-bit running sum truncates
+    int sumv = (int32_t)aggregate->sum;
+
+    if (formula->op == FORMULA_MIN || formula->op == FORMULA_MAX)
+    {
+        if (aggregate->extremum_count == 0)
+            aggregate_rescan_extremum(sheet, formula, aggregate);
+        *error = 0;
+        return aggregate->extremum;
+    }
+    else if (formula->op == FORMULA_SUM)
+    {
+        *error = 0;
+        return sumv;
+    }
+    else if (formula->op == FORMULA_AVG)
+    {
+        *error = 0;
+        return (count == 0) ? 0 : (sumv / count);
+    }
+    else if (formula->op == FORMULA_STDEV)
+    {
+        if (count < 2)
         {
-            cell_destroy(sheet->cells[col * (r - 1) + (c - 1)]);
+            return 0;
         }
+        int mean = sumv / count;
+        // The squared deviations from the int mean, expanded over the running sums
+        __int128 deviation = aggregate->sum_squares - 2 * (__int128)mean * aggregate->sum +
+                             (__int128)count * mean * mean;
+        double variance = (double)deviation;
+        variance /= (count);
+        *error = 0;
+        return (int)round(sqrt(variance));
+    }
+    return 0;
+}
+
+/* Stores the value and error flag of a cell, and passes the change on to every
+   range formula reading the cell so their aggregates stay current */
+void spreadsheet_store_value(Spreadsheet *sheet, int row, int col, int value, char error)
+{
+    int id = spreadsheet_cell_id(sheet, row, col);
+    uint64_t bit = (uint64_t)1 << (id & 63);
+    int old_value = sheet->values[id];
+    int old_error = (sheet->errors[id >> 6] & bit) != 0;
+    sheet->values[id] = value;
+    if (error)
+        sheet->errors[id >> 6] |= bit;
+    else
+        sheet->errors[id >> 6] &= ~bit;
+
+    if (sheet->prefix != NULL && old_value != value)
+        prefixsum_add(sheet->prefix, row, col, (int64_t)value - old_value);
+    if (sheet->minmax != NULL && old_value != value)
+        minmaxtree_update(sheet->minmax, row, col, old_value, value);
+
+    int new_error = error != 0;
+    if (sheet->ranges->size > 0 && (old_value != value || old_error != new_error))
+    {
+        ValueDelta delta = {sheet, old_value, value, new_error - old_error};
+        rangeindex_query(sheet->ranges, row, col, apply_value_delta, &delta);
     }
-    free(sheet->cells);
-    free(sheet);
 }
+
 /* ----------------
    Column <-> Letter
    ---------------- */
@@ -241,891 +622,1239 @@ int isNumeric(const char *str)
     return (*endptr == '\0'); // If endptr points to '\0', it's a valid integer
 }
 
-/* Function to extract start row start col end row and end col from a given formula */
+/* Function to extract start row start col end row and end col from a parsed formula.
+   Ranges give their rectangle, anything else the cells of its two operands or -1 */
 
-int find_depends(const char *formula, Spreadsheet *sheet, int *r1, int *r2, int *c1, int *c2, int *range_bool)
+int find_depends(const Formula *formula, const Spreadsheet *sheet, int *r1, int *r2, int *c1, int *c2, int *range_bool)
 {
-    // fprintf(stderr, "find_depends start");
-    *range_bool = 0;
-    const char *ranges[] = {"MIN", "MAX", "AVG", "SUM", "STDEV"};
-    // start with this or not :
-    int i;
-    for (i = 0; i < 5; i++)
+    *range_bool = formula_is_range(formula);
+    if (*range_bool)
     {
-        if (strncmp(formula, ranges[i], strlen(ranges[i])) == 0)
-        {
-            *range_bool = 1;
-            char *brack_sign = strchr(formula, '(');
-            const char *new_formula = brack_sign + 1;
-            int temp = strlen(new_formula);
-            // printf("%s",new_formula);
-            char only_range[100];
-            strncpy(only_range, new_formula, temp - 1);
-            only_range[temp - 1] = '\0';
-            // printf("%s", only_range);
-            int col1, row1, col2, row2;
-            char col_start[10], col_end[10];
-            if (sscanf(only_range, "%[A-Z]%d:%[A-Z]%d", col_start, &row1, col_end, &row2) == 4)
-            {
-                col1 = col_to_index(col_start);
-                col2 = col_to_index(col_end);
-                row1--; // Convert to 0-based index
-                row2--;
-
-                if (col2 < col1)
-                {
-                    // fprintf(stderr, "Invalid formula format.\n");
-                    return -1;
-                }
-                else if (col1 == col2 && row2 < row1)
-                {
-                    // fprintf(stderr, "Invalid formula format.\n");
-                    return -1;
-                }
-                *r1 = row1;
-                *r2 = row2;
-                *c1 = col1;
-                *c2 = col2;
-            }
-        }
+        *r1 = formula->r1;
+        *r2 = formula->r2;
+        *c1 = formula->c1;
+        *c2 = formula->c2;
+        return 0;
     }
-    // it is not of the range form then :
-    if (i >= 5)
+    *r1 = *r2 = *c1 = *c2 = -1;
+    if (formula->lhs.id != FORMULA_NO_CELL)
     {
-        *r1 = -1;
-        *r2 = -1;
-        *c1 = -1;
-        *c2 = -1;
-
-        if (formula && strlen(formula) > 0)
-        {
-            // We'll do a simple regex to find references
-            // this will only extract the cell references because only they are the ones to be sent to new_depends, it does nothing with the constant operands
-            regex_t refRegex;
-            regcomp(&refRegex, "([A-Za-z]+[0-9]+)", REG_EXTENDED);
-            const char *p = formula;
-            regmatch_t m;
-            int cnt = 0;
-            while (regexec(&refRegex, p, 1, &m, 0) == 0)
-            {
-                char ref[64];
-                int len = m.rm_eo - m.rm_so;
-                strncpy(ref, p + m.rm_so, len);
-                ref[len] = '\0';
-                p += m.rm_eo;
-                // printf("%s\n", ref);
-                // fprintf(stderr, "%s this is going to new_depends\n", ref);
-                if (cnt == 0)
-                {
-                    spreadsheet_parse_cell_name(sheet, ref, r1, c1);
-                }
-                if (cnt == 1)
-                {
-                    spreadsheet_parse_cell_name(sheet, ref, r2, c2);
-                }
-                // orderedset_insert(new_depends, ref);
-                cnt++;
-
-            }
-            regfree(&refRegex);
-        }
+        *r1 = formula->lhs.id / sheet->cols + 1;
+        *c1 = formula->lhs.id % sheet->cols + 1;
+    }
+    if (formula->rhs.id != FORMULA_NO_CELL)
+    {
+        *r2 = formula->rhs.id / sheet->cols + 1;
+        *c2 = formula->rhs.id % sheet->cols + 1;
     }
     return 0;
 }
-
 /* ----------------
    Expression & Function
    ---------------- */
 
+/* Reads an operand, returns 0 if it references a cell in error */
+static inline int operand_value(const Spreadsheet *sheet, const FormulaOperand *operand, int *out)
+{
+    if (operand->id == FORMULA_NO_CELL)
+    {
+        *out = operand->value;
+        return 1;
+    }
+    if ((sheet->errors[operand->id >> 6] >> (operand->id & 63)) & 1)
+        return 0;
+    *out = operand->value * sheet->values[operand->id];
+    return 1;
+}
+
 /* Function to evaluate RANGE and SLEEP functions */
-int spreadsheet_evaluate_function(Spreadsheet *sheet, const char *func, const char *args, Cell *cell, const char *expr)
+int spreadsheet_evaluate_function(Spreadsheet *sheet, const Formula *formula, char *error)
 {
-    // fprintf(stderr, "[DEBUG] Evaluating function: %s(%s)\n", func, args);
     // SLEEP(value)
-    if (strcasecmp(func, "SLEEP") == 0)
+    if (formula->op == FORMULA_SLEEP)
     {
+        const FormulaOperand *arg = &formula->lhs;
         int val;
-        // case 1 , args is not cell reference
-        if (isNumeric(args))
+        if (arg->id == FORMULA_NO_CELL)
         {
-            val = atoi(args);
-            cell->error = 0;
+            val = arg->value;
+            *error = 0;
         }
-
         else
         {
-            int sign = 1;
-            if (args[0] == '-')
-            {
-                sign = -1;
-                args++;
-            }
-            else if (args[0] == '+')
+            val = arg->value * sheet->values[arg->id];
+            if ((sheet->errors[arg->id >> 6] >> (arg->id & 63)) & 1)
             {
-                args++;
-            }
-            // Cell *op = ordereddict_get(sheet->cells, args);
-            int r_, c_;
-            spreadsheet_parse_cell_name(sheet, args, &r_, &c_);
-            Cell *op = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-            if (!op)
-            {
-                fprintf(stderr, "cell not found\n");
-
-                // no formula ever assigned to this cell . it must have zero value iff it's a valid cell
-                // to be checked for a valid cell logic is inside extract already
-                val = 0;
-            }
-            else
-                val = sign * op->value;
-            if (op->error)
-            {
-                cell->error = 1;
+                *error = 1;
                 return val;
             }
-            else
-            {
-                cell->error = 0;
-            }
+            *error = 0;
         }
-        // int val = spreadsheet_evaluate_expression(sheet, args);
         if (val > 0)
         {
             sleep((unsigned int)val);
         }
-
         return val;
     }
 
-    // Evaluate range
-    int count = 0;
-    int r1, r2, c1, c2, range_bool;
-    find_depends(expr, sheet, &r1, &r2, &c1, &c2, &range_bool);
-    count = (r2 - r1 + 1) * (c2 - c1 + 1);
-    int *values = (int *)malloc(sizeof(int) * count);
-    // fprintf(stderr,"find_depends in which index %d %d %d %d \n",r1,r2,c1,c2);
-    int k = 0;
-    for (int i = r1; i <= r2; i++)
-    {
-        for (int j = c1; j <= c2; j++)
-        {
-            
-            Cell *c = sheet->cells[sheet->cols * (i - 1) + (j - 1)];
-            if (c && c->error)
-            {
-                cell->error = 1;
-                // free(cells);
-                free(values);
-                return 0;
-            }
-            values[k] = c ? c->value : 0;
-            k++;
-           
-        }
-    }
-
-    if (strcasecmp(func, "MIN") == 0)
-    {
-        int minv = values[0];
-        for (int i = 1; i < count; i++)
-            if (values[i] < minv)
-                minv = values[i];
-        free(values);
-        cell->error = 0;
-        return minv;
-    }
-    else if (strcasecmp(func, "MAX") == 0)
-    {
-        int maxv = values[0];
-        for (int i = 1; i < count; i++)
-            if (values[i] > maxv)
-                maxv = values[i];
-        free(values);
-        cell->error = 0;
-        return maxv;
-    }
-    else if (strcasecmp(func, "SUM") == 0)
-    {
-        int sumv = 0;
-        for (int i = 0; i < count; i++)
-            sumv += values[i];
-        free(values);
-        cell->error = 0;
-        return sumv;
-    }
-    else if (strcasecmp(func, "AVG") == 0)
-    {
-        int sumv = 0;
-        for (int i = 0; i < count; i++)
-            sumv += values[i];
-        free(values);
-        cell->error = 0;
-        return (count == 0) ? 0 : (sumv / count);
-    }
-    else if (strcasecmp(func, "STDEV") == 0)
-    {
-        if (count < 2)
-        {
-            free(values);
-            return 0;
-        }
-        int mean = 0;
-        for (int i = 0; i < count; i++)
-            mean += values[i];
-        mean /= count;
-        double variance = 0;
-        for (int i = 0; i < count; i++)
-        {
-            double diff = values[i] - mean;
-            variance += diff * diff;
-        }
-        variance /= (count);
-        free(values);
-        cell->error = 0;
-        return (int)round(sqrt(variance));
-    }
-
-    free(values);
-    // fprintf(stderr, "[ERROR] Unknown function: %s\n", func);
-    return 0;
+    // Evaluate range from an aggregate built on the spot
+    RangeAggregate aggregate;
+    aggregate_build(sheet, formula, &aggregate);
+    return evaluate_range(sheet, formula, &aggregate, error);
 }
 
-/* Function to evaluate expressions in the RHS of the formulas */
+/* Function to evaluate a compiled formula against the current values */
 
-int spreadsheet_evaluate_expression(Spreadsheet *sheet, const char *expr, Cell *cell)
+int spreadsheet_run_formula(Spreadsheet *sheet, const Formula *formula, char *error)
 {
-    if (!expr || strlen(expr) == 0)
-        return 0;
-    // fprintf(stderr, "[DEBUG] Evaluating expression: %s\n", expr);
-
-    // Check for function call pattern: FUNC(...)
-    regex_t funcRegex;
-    regcomp(&funcRegex, "^([A-Za-z]+)\\((.*)\\)$", REG_EXTENDED);
-    regmatch_t matches[3];
-    if (regexec(&funcRegex, expr, 3, matches, 0) == 0)
-    {
-        char func[64], args[256];
-        strncpy(func, expr + matches[1].rm_so, matches[1].rm_eo - matches[1].rm_so);
-        func[matches[1].rm_eo - matches[1].rm_so] = '\0';
-        strncpy(args, expr + matches[2].rm_so, matches[2].rm_eo - matches[2].rm_so);
-        args[matches[2].rm_eo - matches[2].rm_so] = '\0';
-        regfree(&funcRegex);
-        return spreadsheet_evaluate_function(sheet, func, args, cell, expr);
-    }
-    regfree(&funcRegex);
-
-    // Check if the expr is a cell reference (e.g. A1)
-    regex_t cellRegex;
-    regcomp(&cellRegex, "^[A-Za-z]+[0-9]+$", REG_EXTENDED);
-    if (regexec(&cellRegex, expr, 0, NULL, 0) == 0)
-    {
-        // It's a cell reference
-        // Cell *c = ordereddict_get(sheet->cells, expr);
-        int r_, c_;
-        spreadsheet_parse_cell_name(sheet, expr, &r_, &c_);
-        Cell *c = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-        if (!c)
-            fprintf(stderr, "cell not found\n");
-        cell->error = c->error;
-        regfree(&cellRegex);
-        return c ? c->value : 0;
-    }
-    regfree(&cellRegex);
-
-    // Check for arithmetic
-    // We'll do a naive approach: we find + - * / and split
-
-    int temp = strlen(expr);
-    int i = 0;
-    int num1 = 0;
-    int sign1 = 1;
-    if (expr[i] == '+')
-    {
-        i++;
-    }
-    else if (expr[i] == '-')
-    {
-        i++;
-        sign1 = -1;
-    }
-    if (expr[i] >= 48 && expr[i] <= 57)
-    {
-        int j = i;
-        while (j < temp && isdigit(expr[j]))
-        {
-            num1 = num1 * 10 + (expr[j] - '0');
-            j++;
-        }
-        i = j;
-    }
-    else if (expr[i] >= 65 && expr[i] <= 90)
-    {
-        // fprintf(stderr, "goes here1\n");
-        int j = i;
-        while (j < temp && expr[j] >= 65 && expr[j] <= 90)
-        {
-            j++;
-        }
-        int k = j;
-        int row = 0;
-        while (k < temp && isdigit(expr[k]))
-        {
-            row = row * 10 + expr[k] - '0';
-            k++;
-        }
-        int temp_l = k - i;
-        char cell_name_[10];
-        strncpy(cell_name_, expr + i, temp_l);
-        cell_name_[temp_l] = '\0';
-        i = k;
-       
-        int r, c;
-        spreadsheet_parse_cell_name(sheet, cell_name_, &r, &c);
-        Cell *c_ = sheet->cells[sheet->cols * (r - 1) + (c - 1)];
-     
-        if (c_->error)
-        {
-            cell->error = 1;
-            return 0;
-        }
-        num1 = c_->value;
-        // fprintf(stderr, "reaches till here\n");
-    }
-    num1 *= sign1;
-    char operation;
-    if (i < temp)
+    int num1, num2;
+    switch (formula->op)
     {
-        operation = expr[i];
+    case FORMULA_NONE:
+        return 0;
+    case FORMULA_REF:
+        *error = (sheet->errors[formula->lhs.id >> 6] >> (formula->lhs.id & 63)) & 1;
+        return sheet->values[formula->lhs.id];
+    case FORMULA_MIN:
+    case FORMULA_MAX:
+    case FORMULA_SUM:
+    case FORMULA_AVG:
+    case FORMULA_STDEV:
+    case FORMULA_SLEEP:
+        return spreadsheet_evaluate_function(sheet, formula, error);
+    default:
+        break;
+    }
+
+    // Arithmetic, an operand in error makes the whole result an error
+    if (!operand_value(sheet, &formula->lhs, &num1))
+    {
+        *error = 1;
+        return 0;
     }
-    else
+    if (formula->op == FORMULA_VALUE)
     {
-        cell->error = 0;
+        *error = 0;
         return num1;
     }
-    i++;
-    int num2 = 0;
-    int sign2 = 1;
-    if (expr[i] == '+')
-    {
-        i++;
-    }
-    else if (expr[i] == '-')
-    {
-        sign2 = -1;
-        i++;
-    }
-    if (expr[i] >= 48 && expr[i] <= 57)
-    {
-        int j = i;
-        while (j < temp && isdigit(expr[j]))
-        {
-            num2 = num2 * 10 + (expr[j] - '0');
-            j++;
-        }
-        i = j;
-    }
-    else if (expr[i] >= 65 && expr[i] <= 90)
+    if (!operand_value(sheet, &formula->rhs, &num2))
     {
-        // fprintf(stderr, "should go here next\n");
-        int j = i;
-        while (j < temp && expr[j] >= 65 && expr[j] <= 90)
-        {
-            j++;
-        }
-        int k = j;
-        int row = 0;
-        while (k < temp && isdigit(expr[k]))
-        {
-            row = row * 10 + expr[k] - '0';
-            k++;
-        }
-        int temp_l = k - i;
-        char cell_name_[10];
-        strncpy(cell_name_, expr + i, temp_l);
-        cell_name_[temp_l] = '\0';
-        i = k;
-        // Cell *c = ordereddict_get(sheet->cells, cell_name_);
-        int r_, c_;
-        spreadsheet_parse_cell_name(sheet, cell_name_, &r_, &c_);
-        Cell *c = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-        // if (!c)
-        //     fprintf(stderr, "c not in dict\n");
-        if (c->error)
-        {
-            cell->error = 1;
-            return 0;
-        }
-        num2 = c->value;
+        *error = 1;
+        return 0;
     }
-    num2 *= sign2;
-    cell->error = 0;
-    if (operation == '+')
+    *error = 0;
+    if (formula->op == FORMULA_ADD)
     {
         return num1 + num2;
     }
-    else if (operation == '-')
+    else if (formula->op == FORMULA_SUB)
     {
         return num1 - num2;
     }
-    else if (operation == '*')
+    else if (formula->op == FORMULA_MUL)
     {
         return num1 * num2;
     }
-    else if (operation == '/')
+    else
     {
         if (num2 == 0)
         {
-            cell->error = 1;
+            *error = 1;
             return 0;
         }
         return num1 / num2;
     }
-    else
-    {
-        cell->error = 1;
-        return -1;
-    }
 }
 
-/* Recursive DFS using STACK to detect cycle */
+/* The formula of a cell, its template resolved against the cell's position */
 
-int rec_find_cycle_using_stack(Spreadsheet *sheet, int r1, int r2, int c1, int c2, int range_bool, OrderedSet *visited, Node **top)
+void spreadsheet_cell_formula(const Spreadsheet *sheet, const Cell *cell, Formula *out)
 {
-    // orderedset_print(new_depends);
-    while (!isEmpty(*top))
-    {
-        Cell *my_node = pop(top);
-        // get the cell name from my_node->col and my_node->row
-        char temp_col[10];
-        index_to_col((my_node->col) - 1, temp_col);
-        char temp_row[10];
-        sprintf(temp_row, "%d", my_node->row);
-        char *start_key = strcat(temp_col, temp_row);
-        // fprintf(stderr, "key to be checked is %s", start_key);
-        orderedset_insert(visited, start_key);
-        // if (orderedset_contains(new_depends, start_key))
-        if ((range_bool == 1 && (my_node->row >= r1 && my_node->row <= r2 && my_node->col >= c1 && my_node->col <= c2)) || (range_bool == 0 && ((my_node->row == r1 && my_node->col == c1) || (my_node->row == r2 && my_node->col == c2))))
-            return 1;
-        else
-        {
-            
-            char **keys = NULL;
-            int size = 0;
-            if (my_node->container == 0)
-            {
-                vector_collect_keys(my_node->dependents.dependents_vector, &keys, &size);
-            }
-            else
-            {
-                v_orderedset_collect_keys(my_node->dependents.dependents_set, &keys, &size);
-            }
+    formula_anchor(templatetable_shape(sheet->templates, cell->shape), cell->row, cell->col, sheet->cols, out);
+}
 
-            for (int i = 0; i < size; i++)
-            {
-                // If the key has not been visited, recurse to find a cycle
-                if (!orderedset_contains(visited, keys[i]))
-                {
-                    // Cell *neighbour_node = ordereddict_get(dict, keys[i]);
-                    int r_, c_;
-                    spreadsheet_parse_cell_name(sheet, keys[i], &r_, &c_);
-                    Cell *neighbour_node = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-                    if (!neighbour_node)
-                    {
-                       
-                        if (orderedset_contains(visited, keys[i]))
-                        {
-                            for (int x = 0; x < size; x++)
-                            {
-                                free(keys[x]);
-                            }
-                        }
-
-                        if (keys)
-                        {
-                            free(keys);
-                        }
-                        return 1;
-                    }
-                    push(top, neighbour_node);
-                }
-            }
-            for (int x = 0; x < size; x++)
-                free(keys[x]);
-            if (keys)
-                free(keys);
-            
-        }
-    }
-    return 0;
+/* Writes the formula of the cell at (row, col) as text, empty if it has none. Only
+   templates are kept, so this is the canonical text and not the one typed in */
+
+int spreadsheet_formula_text(const Spreadsheet *sheet, int row, int col, char *buf, size_t size)
+{
+    Formula formula;
+    spreadsheet_cell_formula(sheet, spreadsheet_peek_cell(sheet, row, col), &formula);
+    return formula_format(&formula, sheet->cols, buf, size);
 }
 
-/* Helper functions to convert ordered set or vector to a simple array of chars for traversal */
+/* Evaluates the formula of a cell, range formulas are answered from their running aggregate */
+
+int spreadsheet_evaluate_cell(Spreadsheet *sheet, Cell *cell, char *error)
+{
+    Formula formula;
+    spreadsheet_cell_formula(sheet, cell, &formula);
+    if (cell->aggregate != NULL)
+        return evaluate_range(sheet, &formula, cell->aggregate, error);
+    return spreadsheet_run_formula(sheet, &formula, error);
+}
+
+/* Function to evaluate expressions in the RHS of the formulas */
 
-void v_inorder_traversal_helper(OrderedSetNode *node, char **array, int *index)
+int spreadsheet_evaluate_expression(Spreadsheet *sheet, const char *expr, char *error)
 {
-    if (node == NULL)
+    if (!expr || strlen(expr) == 0)
+        return 0;
+    Formula formula;
+    if (!formula_parse(expr, sheet->rows, sheet->cols, &formula))
     {
-        return;
+        *error = 1;
+        return 0;
     }
+    return spreadsheet_run_formula(sheet, &formula, error);
+}
 
-    // Traverse the left subtree
-    v_inorder_traversal_helper(node->left, array, index);
-
-    // Visit the current node and add the key to the array
-    array[*index] = strdup(node->key); // Assuming strdup is available for deep copying
-    (*index)++;
+/* Visits every cell whose formula reads cell: its point dependents, from the snapshot
+   unless they were edited since, then the range formulas whose rectangle covers it */
 
-    // Traverse the right subtree
-    v_inorder_traversal_helper(node->right, array, index);
+void spreadsheet_dep_foreach(const Spreadsheet *sheet, const Cell *cell, void (*func)(uint32_t, void *), void *ctx)
+{
+    if (cell->frozen != CELL_NOT_FROZEN)
+        csrgraph_foreach(sheet->frozen, cell->frozen, func, ctx);
+    else
+        cell_dep_foreach(cell, func, ctx);
+    rangeindex_query(sheet->ranges, cell->row, cell->col, func, ctx);
 }
 
-// Public function to collect all keys in an array
-int count_nodes(OrderedSetNode *node)
+/* The point dependents of cell were edited, its own set is read instead of its
+   snapshot node until the next freeze */
+static inline void dep_edited(Spreadsheet *sheet, Cell *cell)
 {
-    if (node == NULL)
-        return 0;
-    return count_nodes(node->left) + count_nodes(node->right) + 1;
+    cell->frozen = CELL_NOT_FROZEN;
+    sheet->graph_edits++;
 }
-void vector_collect_keys(Vector *vec, char ***array, int *size)
+
+/* Visits every cell the formula of cell reads, once each, from the ids and rectangle
+   resolved when the formula was assigned */
+
+void spreadsheet_prec_foreach(const Spreadsheet *sheet, const Cell *cell, void (*func)(uint32_t, void *), void *ctx)
 {
-    if (vec == NULL || vec->size == 0)
+    if (cell->shape == TEMPLATE_NONE)
+        return;
+    Formula resolved;
+    spreadsheet_cell_formula(sheet, cell, &resolved);
+    const Formula *formula = &resolved;
+    if (formula_is_range(formula))
     {
-        *array = NULL;
-        *size = 0;
+        for (int row = formula->r1; row <= formula->r2; row++)
+        {
+            uint32_t id = spreadsheet_cell_id(sheet, row, formula->c1);
+            for (int col = formula->c1; col <= formula->c2; col++, id++)
+                func(id, ctx);
+        }
         return;
     }
+    if (formula->lhs.id != FORMULA_NO_CELL)
+        func(formula->lhs.id, ctx);
+    if (formula->rhs.id != FORMULA_NO_CELL && formula->rhs.id != formula->lhs.id)
+        func(formula->rhs.id, ctx);
+}
 
-    // First, find the number of nodes in the set
-    *size = 0;
+typedef struct DetachWalk
+{
+    Spreadsheet *sheet;
+    uint32_t dependent;
+} DetachWalk;
 
-    *size = vec->size;
+static void detach_dependent(uint32_t id, void *ctx)
+{
+    DetachWalk *walk = (DetachWalk *)ctx;
+    Cell *precedent = spreadsheet_find_cell(walk->sheet, id / walk->sheet->cols + 1, id % walk->sheet->cols + 1);
+    if (precedent)
+    {
+        cell_dep_remove(precedent, walk->dependent);
+        dep_edited(walk->sheet, precedent);
+    }
+}
 
-    // Allocate memory for the array to store the keys;
-    *array = malloc(sizeof(char *) * (*size));
+/* Function to remove Cell from the adjacency list if formula is changed */
 
-    // Perform inorder traversal and collect the keys in the array
-    for (int i = 0; i < vec->size; i++)
+void remove_old_dependents(Spreadsheet *sheet, Cell *cell)
+{
+    uint32_t cell_id = spreadsheet_cell_id(sheet, cell->row, cell->col);
+    if (cell->shape == TEMPLATE_NONE)
     {
-        (*array)[i] = strdup(vec->data[i]);
+        return;
+    }
+    Formula resolved;
+    spreadsheet_cell_formula(sheet, cell, &resolved);
+    const Formula *formula = &resolved;
+
+    // The range was registered once under its start row
+    if (formula_is_range(formula))
+    {
+        rangeindex_remove(sheet->ranges, cell_id, formula->r1);
+        return;
     }
+    DetachWalk walk = {sheet, cell_id};
+    spreadsheet_prec_foreach(sheet, cell, detach_dependent, &walk);
 }
-void v_orderedset_collect_keys(OrderedSet *set, char ***array, int *size)
+
+/* Function to update dependencies when some new formula assigned */
+
+int v_spreadsheet_update_dependencies(Spreadsheet *sheet, Cell *cell, const Formula *formula)
 {
+    uint32_t cell_id = spreadsheet_cell_id(sheet, cell->row, cell->col);
 
-    if (set == NULL || set->root == NULL)
+    // Remove old dependencies
+    remove_old_dependents(sheet, cell);
+
+    // One rectangle in the range index instead of an entry in every covered cell
+    if (formula_is_range(formula))
     {
-        *array = NULL;
-        *size = 0;
-        return;
+        rangeindex_insert(sheet->ranges, cell_id, formula->r1, formula->r2, formula->c1, formula->c2);
+        return 0;
+    }
+    // A cell read twice (A1+A1) is one edge, the same way detaching visits it once
+    if (formula->lhs.id != FORMULA_NO_CELL)
+    {
+        Cell *precedent = spreadsheet_get_cell_by_id(sheet, formula->lhs.id);
+        cell_dep_insert(precedent, cell_id);
+        dep_edited(sheet, precedent);
     }
+    if (formula->rhs.id != FORMULA_NO_CELL && formula->rhs.id != formula->lhs.id)
+    {
+        Cell *precedent = spreadsheet_get_cell_by_id(sheet, formula->rhs.id);
+        cell_dep_insert(precedent, cell_id);
+        dep_edited(sheet, precedent);
+    }
+    return 0;
+}
 
-    // First, find the number of nodes in the set
-    *size = 0;
+/* ----------------
+   Graph Walks
+   ---------------- */
 
-    *size = count_nodes(set->root);
+/* Starts a new walk, every mark from an older epoch reads as unvisited */
+static uint32_t recalc_next_epoch(Spreadsheet *sheet)
+{
+    if (++sheet->epoch == 0)
+    {
+        memset(sheet->marks, 0, (size_t)sheet->rows * sheet->cols * sizeof(uint32_t));
+        sheet->epoch = 1;
+    }
+    return sheet->epoch;
+}
 
-    // Allocate memory for the array to store the keys;
-    *array = malloc(sizeof(char *) * (*size));
-    int index = 0;
-    // Perform inorder traversal and collect the keys in the array
-    v_inorder_traversal_helper(set->root, *array, &index);
+/* Makes room for index size in the walk buffers, which are kept between walks */
+static void recalc_reserve(Spreadsheet *sheet, int size)
+{
+    if (size < sheet->walk_capacity)
+        return;
+    int capacity = sheet->walk_capacity ? sheet->walk_capacity * 2 : 64;
+    while (capacity <= size)
+        capacity *= 2;
+    sheet->stack = (uint32_t *)realloc(sheet->stack, capacity * sizeof(uint32_t));
+    sheet->order = (uint32_t *)realloc(sheet->order, capacity * sizeof(uint32_t));
+    sheet->queue = (uint64_t *)realloc(sheet->queue, capacity * sizeof(uint64_t));
+    sheet->results = (RecalcResult *)realloc(sheet->results, capacity * sizeof(RecalcResult));
+    if (sheet->stack == NULL || sheet->order == NULL || sheet->queue == NULL || sheet->results == NULL)
+    {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    sheet->walk_capacity = capacity;
 }
 
-/* This is the very function called after validation of any cell . Checks cycles */
+static inline const Cell *recalc_cell(const Spreadsheet *sheet, uint32_t id)
+{
+    return spreadsheet_peek_cell(sheet, id / sheet->cols + 1, id % sheet->cols + 1);
+}
+
+/* Marks the cell for the current walk, returns 0 if it already was */
+static inline int recalc_mark(Spreadsheet *sheet, uint32_t id)
+{
+    if (sheet->marks[id] == sheet->epoch)
+        return 0;
+    sheet->marks[id] = sheet->epoch;
+    return 1;
+}
+
+// Runs of equally ranked cells shorter than this are evaluated on the calling thread
+#define PARALLEL_MIN_LEVEL 256
+#define PARALLEL_MIN_CHUNK 64
+
+typedef struct RecalcLevel
+{
+    Spreadsheet *sheet;
+    const uint32_t *cells;
+} RecalcLevel;
+
+typedef struct RecalcWalk
+{
+    Spreadsheet *sheet;
+    int size;
+    int bound;      // cycle search: only cells ranked at most this can reach a precedent
+} RecalcWalk;
+
+/* ----------------
+   Topological Ranks
+   ---------------- */
+
+/* Every cell ranks strictly above each cell its formula reads, so along any dependency
+   path the ranks rise. Ranks only ever go up, removing a formula leaves them valid */
+
+static void rank_set(Spreadsheet *sheet, uint32_t id, int rank)
+{
+    if (sheet->rank_tree != NULL)
+        minmaxtree_update(sheet->rank_tree, id / sheet->cols + 1, id % sheet->cols + 1, sheet->ranks[id], rank);
+    sheet->ranks[id] = rank;
+}
 
-int first_step_find_cycle(Spreadsheet *sheet, char *cell_name, int r1, int r2, int c1, int c2, int range_bool)
+/* Highest rank among the cells a formula reads, -1 if it reads none */
+int spreadsheet_precedent_rank(Spreadsheet *sheet, int r1, int r2, int c1, int c2, int range_bool)
 {
+    if (range_bool)
+    {
+        // Max rank over a rectangle from tiled summaries of the rank grid
+        if (sheet->rank_tree == NULL)
+            sheet->rank_tree = minmaxtree_create(sheet->ranks, sheet->rows, sheet->cols);
+        int min, max;
+        minmaxtree_query(sheet->rank_tree, r1, r2, c1, c2, &min, &max);
+        return max;
+    }
+    int rank = -1;
+    if (r1 != -1)
+        rank = sheet->ranks[spreadsheet_cell_id(sheet, r1, c1)];
+    if (r2 != -1 && sheet->ranks[spreadsheet_cell_id(sheet, r2, c2)] > rank)
+        rank = sheet->ranks[spreadsheet_cell_id(sheet, r2, c2)];
+    return rank;
+}
 
-    // Cell *cell = ordereddict_get(sheet->cells, cell_name);
-    int r_, c_;
-    spreadsheet_parse_cell_name(sheet, cell_name, &r_, &c_);
+/* Raises a dependent that no longer ranks above the cell that just rose */
+static void rank_push_dependent(uint32_t id, void *ctx)
+{
+    RecalcWalk *walk = (RecalcWalk *)ctx;
+    Spreadsheet *sheet = walk->sheet;
+    if (sheet->ranks[id] > walk->bound)
+        return;
+    rank_set(sheet, id, walk->bound + 1);
+    recalc_reserve(sheet, walk->size);
+    sheet->stack[walk->size++] = id;
+}
 
-    OrderedSet *visited = orderedset_create();
-   
-    Cell *node_of_start = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-    if (!node_of_start)
+/* Places a cell whose formula reads cells ranked up to bound above all of them, and
+   moves up only the dependents whose rank that disturbs */
+static void rank_raise(Spreadsheet *sheet, uint32_t id, int bound)
+{
+    if (sheet->ranks[id] > bound)
+        return;
+    rank_set(sheet, id, bound + 1);
+    RecalcWalk walk = {sheet, 0, 0};
+    recalc_reserve(sheet, 0);
+    sheet->stack[walk.size++] = id;
+    while (walk.size > 0)
     {
-        orderedset_destroy(visited);
-        return 0;
+        uint32_t raised = sheet->stack[--walk.size];
+        walk.bound = sheet->ranks[raised];
+        spreadsheet_dep_foreach(sheet, recalc_cell(sheet, raised), rank_push_dependent, &walk);
     }
+}
+
+/* ----------------
+   Dependency Snapshot
+   ---------------- */
+
+/* Dependents that spilled out of a cell into a hash table are frozen into one CSR
+   snapshot, sorted and back to back, for the walks to scan. Up to DEPSET_INLINE of them
+   sit inside the cell already, on the line the walk reads anyway, so those stay where
+   they are. Edits keep going to the cells' own sets and an edited cell is read from
+   its set until the next freeze, so the snapshot never has to change */
+
+// Dependency edits before the snapshot is rebuilt, once they also outnumber its edges
+#define FREEZE_MIN_EDITS 4096
+
+static int compare_keys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void freeze_edge(uint32_t id, void *ctx)
+{
+    csrgraph_add_edge((CsrGraph *)ctx, id);
+}
 
-    // start was never in rhs of any formula before there can't be cyclic dependency
-    Node *top = createNode(node_of_start);
-    
-    if (rec_find_cycle_using_stack(sheet, r1, r2, c1, c2, range_bool, visited, &top))
+/* Points the cells of the current snapshot back at their own sets */
+static void freeze_release(Spreadsheet *sheet)
+{
+    for (uint32_t node = 0; node < sheet->frozen->node_count; node++)
+        spreadsheet_get_cell_by_id(sheet, sheet->frozen->sources[node])->frozen = CELL_NOT_FROZEN;
+    csrgraph_clear(sheet->frozen);
+}
+
+/* Rebuilds the snapshot from every spilled set, in rank order so that a walk rising
+   through the ranks reads the targets array mostly front to back */
+void spreadsheet_freeze_dependents(Spreadsheet *sheet)
+{
+    if (sheet->frozen == NULL)
+        sheet->frozen = csrgraph_create();
+    else
+        freeze_release(sheet);
+
+    int count = 0;
+    int page_count = sheet->page_rows * sheet->page_cols;
+    for (int p = 0; p < page_count; p++)
     {
-        // fprintf(stderr, "correct");
-        destroyStack(&top);
-        orderedset_destroy(visited);
-        return 1;
+        Cell **page = sheet->pages[p];
+        if (page == NULL)
+            continue;
+        for (int i = 0; i < SHEET_PAGE_ROWS * SHEET_PAGE_COLS; i++)
+        {
+            if (page[i] == NULL || page[i]->dependents.capacity == 0)
+                continue;
+            uint32_t id = spreadsheet_cell_id(sheet, page[i]->row, page[i]->col);
+            recalc_reserve(sheet, count);
+            sheet->queue[count++] = (uint64_t)sheet->ranks[id] << 32 | id;
+        }
     }
-    // fprintf(stderr, "[DEBUG]13\n");
-    destroyStack(&top);
-    orderedset_destroy(visited);
-    return 0;
+    qsort(sheet->queue, count, sizeof(uint64_t), compare_keys);
+    for (int i = 0; i < count; i++)
+    {
+        Cell *cell = spreadsheet_get_cell_by_id(sheet, (uint32_t)sheet->queue[i]);
+        cell->frozen = csrgraph_add_node(sheet->frozen, (uint32_t)sheet->queue[i]);
+        cell_dep_foreach(cell, freeze_edge, sheet->frozen);
+    }
+    csrgraph_sort_edges(sheet->frozen);
+    sheet->graph_edits = 0;
 }
 
-/* Function to remove Cell from the adjacency list if formula is changed */
+/* Drops the snapshot, walks read every cell's own set again until the next freeze */
+void spreadsheet_thaw_dependents(Spreadsheet *sheet)
+{
+    if (sheet->frozen == NULL)
+        return;
+    freeze_release(sheet);
+    csrgraph_destroy(sheet->frozen);
+    sheet->frozen = NULL;
+    sheet->graph_edits = 0;
+}
 
-void remove_old_dependents(Spreadsheet *sheet, const char *cell_name)
+/* Refreezes once enough of the graph was edited to pay for the rebuild */
+static void freeze_if_stale(Spreadsheet *sheet)
 {
-    // Cell *cell = ordereddict_get(sheet->cells, cell_name);
-    int r_, c_;
-    spreadsheet_parse_cell_name(sheet, cell_name, &r_, &c_);
-    Cell *cell = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
+    if (sheet->graph_edits >= FREEZE_MIN_EDITS &&
+        (sheet->frozen == NULL || sheet->graph_edits >= sheet->frozen->edge_count))
+        spreadsheet_freeze_dependents(sheet);
+}
+
+/* ----------------
+   Recalculation Order
+   ---------------- */
 
-    // OrderedSet *old_depends = orderedset_create();
-    char *formula = cell->formula;
-    if (formula == NULL)
+/* Binary min-heap of (rank << 32 | id), so cells come out by rank */
+static void queue_push(uint64_t *queue, int *size, uint64_t key)
+{
+    int i = (*size)++;
+    while (i > 0 && queue[(i - 1) / 2] > key)
     {
-        return;
+        queue[i] = queue[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
-    // fprintf(stderr, "[DEBUG]19\n");
-    char *cpy_formula = malloc(strlen(formula) + 1);
-    strcpy(cpy_formula, formula);
+    queue[i] = key;
+}
 
-    // ###
-    const char *ranges[] = {"MIN", "MAX", "AVG", "SUM", "STDEV"};
-    // start with this or not :
-    int i;
-    for (i = 0; i < 5; i++)
+static uint64_t queue_pop(uint64_t *queue, int *size)
+{
+    uint64_t top = queue[0];
+    uint64_t last = queue[--(*size)];
+    int i = 0;
+    for (;;)
     {
-        // fprintf(stderr,"entering loop %d time\n",i);
-        if (strncmp(cpy_formula, ranges[i], strlen(ranges[i])) == 0)
-        {
-            char *brack_sign = strchr(cpy_formula, '(');
-            const char *new_formula = brack_sign + 1;
-            int temp = strlen(new_formula);
-            // printf("%s",new_formula);
-            char only_range[100];
-            strncpy(only_range, new_formula, temp - 1);
-            only_range[temp - 1] = '\0';
-            // printf("%s", only_range);
-
-            int col1, row1, col2, row2;
-            char col_start[10], col_end[10];
-
-            // Parse range format like "A1:B3"
-            if (sscanf(only_range, "%[A-Z]%d:%[A-Z]%d", col_start, &row1, col_end, &row2) == 4)
-            {
-                col1 = col_to_index(col_start);
-                col2 = col_to_index(col_end);
-                row1--; // Convert to 0-based index
-                row2--;
-                clock_t start = clock();
-                for (int r = row1; r <= row2; r++)
-                {
-                    for (int c = col1; c <= col2; c++)
-                    {
-                        char col_name[10];
-                        index_to_col(c, col_name);
-                        Cell *dep_cell = sheet->cells[sheet->cols * (r ) + (c )];
-                        if (!dep_cell)
-                        {
-                            fprintf(stderr, "cell not found\n");
-                        }
-                        cell_dep_remove(dep_cell, cell_name);
-
-                    }
-                }
-                clock_t end = clock();
-                double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
-                // printf("Time taken by loop in extract_visible_cell: %f\n", time_taken);
-            }
+        int child = 2 * i + 1;
+        if (child >= *size)
             break;
-        }
+        if (child + 1 < *size && queue[child + 1] < queue[child])
+            child++;
+        if (queue[child] >= last)
+            break;
+        queue[i] = queue[child];
+        i = child;
     }
-    // it is not of the range form then :
-    if (i >= 5)
+    queue[i] = last;
+    return top;
+}
+
+static void recalc_enqueue(uint32_t id, void *ctx)
+{
+    RecalcWalk *walk = (RecalcWalk *)ctx;
+    Spreadsheet *sheet = walk->sheet;
+    if (!recalc_mark(sheet, id))
+        return;
+    recalc_reserve(sheet, walk->size);
+    queue_push(sheet->queue, &walk->size, (uint64_t)sheet->ranks[id] << 32 | id);
+}
+
+/* Orders starting and every cell that transitively reads it so each comes after all of
+   its dependencies. Cells leave a queue keyed by rank, a cell's dependencies inside the
+   cone all rank lower so they have left before it. The order is left in a buffer owned
+   by the sheet, valid until the next call */
+int spreadsheet_recalc_order(Spreadsheet *sheet, const Cell *starting, const uint32_t **order)
+{
+    recalc_next_epoch(sheet);
+    RecalcWalk walk = {sheet, 0, 0};
+    recalc_enqueue(spreadsheet_cell_id(sheet, starting->row, starting->col), &walk);
+    int count = 0;
+    while (walk.size > 0)
     {
-        // fprintf(stderr,"entering here i>=5 \n");
-        int r1, r2, c1, c2, range_bool;
-        find_depends(cpy_formula, sheet, &r1, &r2, &c1, &c2, &range_bool);
-        // v_orderedset_collect_keys(new_depends, &key, &size);
+        uint32_t id = (uint32_t)queue_pop(sheet->queue, &walk.size);
+        recalc_reserve(sheet, count);
+        sheet->order[count++] = id;
+        spreadsheet_dep_foreach(sheet, recalc_cell(sheet, id), recalc_enqueue, &walk);
+    }
+    *order = sheet->order;
+    return count;
+}
 
-        if (r1 > 0)
+/* Evaluates one run of equally ranked cells into the results buffer */
+static void evaluate_level_task(int begin, int end, void *ctx)
+{
+    const RecalcLevel *level = (const RecalcLevel *)ctx;
+    Spreadsheet *sheet = level->sheet;
+    for (int i = begin; i < end; i++)
+    {
+        uint32_t id = level->cells[i];
+        Cell *target = spreadsheet_find_cell(sheet, id / sheet->cols + 1, id % sheet->cols + 1);
+        char error = (sheet->errors[id >> 6] >> (id & 63)) & 1;
+        sheet->results[i].value = spreadsheet_evaluate_cell(sheet, target, &error);
+        sheet->results[i].error = error;
+    }
+}
+
+/* Stores a recalculated cell. Only a cell whose value or error flag changed passes the
+   recalculation on to its dependents, the others are kept on the stack for the count of
+   skipped cells */
+static void recalc_store(RecalcWalk *walk, int *unchanged, uint32_t id, int value, char error)
+{
+    Spreadsheet *sheet = walk->sheet;
+    if (sheet->values[id] == value && spreadsheet_get_error(sheet, id / sheet->cols + 1, id % sheet->cols + 1) == (error != 0))
+    {
+        recalc_reserve(sheet, *unchanged);
+        sheet->stack[(*unchanged)++] = id;
+        return;
+    }
+    spreadsheet_store_value(sheet, id / sheet->cols + 1, id % sheet->cols + 1, value, error);
+    spreadsheet_dep_foreach(sheet, recalc_cell(sheet, id), recalc_enqueue, walk);
+}
+
+static void recalc_count_skipped(uint32_t id, void *ctx)
+{
+    Spreadsheet *sheet = (Spreadsheet *)ctx;
+    if (recalc_mark(sheet, id))
+        sheet->stats.skipped++;
+}
+
+/* Recalculates the starting cells and whatever their changes reach, in one pass over the
+   union of their cones. Cells leave the rank-keyed queue a whole rank at a time, by then
+   every precedent that could still change has been stored. A cell is queued only once a
+   precedent actually changed, so an edit absorbed early (a MAX that keeps its value) stops
+   there. With a thread pool a large enough rank is evaluated in parallel, its stores still
+   happen one by one afterwards since a store updates the aggregates, prefix sums and
+   MIN/MAX tiles shared with other cells */
+static void recalc_from(Spreadsheet *sheet, const uint32_t *starting, int starts)
+{
+    recalc_next_epoch(sheet);
+    RecalcWalk walk = {sheet, 0, 0};
+    for (int i = 0; i < starts; i++)
+        recalc_enqueue(starting[i], &walk);
+    int unchanged = 0;
+    while (walk.size > 0)
+    {
+        uint64_t rank = sheet->queue[0] >> 32;
+        int count = 0;
+        while (walk.size > 0 && sheet->queue[0] >> 32 == rank)
         {
-            Cell *dep_cell = sheet->cells[sheet->cols * (r1 - 1) + (c1 - 1)];
-            cell_dep_remove(dep_cell, cell_name);
+            recalc_reserve(sheet, count);
+            sheet->order[count++] = (uint32_t)queue_pop(sheet->queue, &walk.size);
         }
-        if (r2 > 0)
+        sheet->stats.evaluated += count;
+        if (sheet->pool != NULL && count >= PARALLEL_MIN_LEVEL)
         {
-            Cell *dep_cell = sheet->cells[sheet->cols * (r2 - 1) + (c2 - 1)];
-            cell_dep_remove(dep_cell, cell_name);
+            RecalcLevel level = {sheet, sheet->order};
+            threadpool_run(sheet->pool, count, PARALLEL_MIN_CHUNK, evaluate_level_task, &level);
+            for (int i = 0; i < count; i++)
+                recalc_store(&walk, &unchanged, sheet->order[i], sheet->results[i].value, sheet->results[i].error);
+        }
+        else
+        {
+            for (int i = 0; i < count; i++)
+            {
+                uint32_t id = sheet->order[i];
+                Cell *target = spreadsheet_get_cell_by_id(sheet, id);
+                char error = spreadsheet_get_error(sheet, target->row, target->col);
+                int x = spreadsheet_evaluate_cell(sheet, target, &error);
+                recalc_store(&walk, &unchanged, id, x, error);
+            }
         }
+    }
+    // Dependents of unchanged cells that no changed cell queued were left as they are
+    sheet->stats.unchanged += unchanged;
+    for (int i = 0; i < unchanged; i++)
+        spreadsheet_dep_foreach(sheet, recalc_cell(sheet, sheet->stack[i]), recalc_count_skipped, sheet);
+}
 
+void spreadsheet_recalc(Spreadsheet *sheet, const Cell *starting)
+{
+    uint32_t id = spreadsheet_cell_id(sheet, starting->row, starting->col);
+    recalc_from(sheet, &id, 1);
+}
+
+/* ----------------
+   Manual Recalculation
+   ---------------- */
+
+/* In manual mode an assignment is checked for cycles and joins the dependency graph as
+   usual, but its cell is only noted. The noted cells are recalculated together when
+   the pending work is run, so a batch of edits pays for one merged recalculation */
+
+static void manual_defer(Spreadsheet *sheet, uint32_t id)
+{
+    if (sheet->pending_count == sheet->pending_capacity)
+    {
+        sheet->pending_capacity = sheet->pending_capacity ? sheet->pending_capacity * 2 : 64;
+        sheet->pending = (uint32_t *)realloc(sheet->pending, sheet->pending_capacity * sizeof(uint32_t));
+        if (sheet->pending == NULL)
+        {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
+        }
     }
-    // ###
-    free(cpy_formula);
+    sheet->pending[sheet->pending_count++] = id;
 }
 
-/* Function to update dependencies when some new formula assigned */
+/* Recalculates everything the assignments since the last run have changed */
+void spreadsheet_recalc_pending(Spreadsheet *sheet)
+{
+    if (sheet->pending_count == 0)
+        return;
+    recalc_from(sheet, sheet->pending, sheet->pending_count);
+    sheet->pending_count = 0;
+}
 
-int v_spreadsheet_update_dependencies(Spreadsheet *sheet, const char *cell_name, const char *formula)
+/* Switches manual mode on or off, switching it off runs the pending recalculation */
+void spreadsheet_set_manual(Spreadsheet *sheet, int manual)
 {
-    int r_, c_;
-    spreadsheet_parse_cell_name(sheet, cell_name, &r_, &c_);
+    sheet->manual = manual;
+    if (!manual)
+        spreadsheet_recalc_pending(sheet);
+}
 
-    // Remove old dependencies
-    remove_old_dependents(sheet, cell_name);
+/* ----------------
+   Lazy Evaluation
+   ---------------- */
+
+/* In lazy mode an edit only marks itself and its downstream cone dirty. A dirty cell's
+   dependents are always dirty too, so marking stops at cells that already are. Values
+   are computed when a cell is resolved, each dirty cell at most once */
 
-    // fprintf(stderr, "[DEBUG]14\n");
+static inline int lazy_is_dirty(const Spreadsheet *sheet, uint32_t id)
+{
+    return (sheet->dirty[id >> 6] >> (id & 63)) & 1;
+}
 
-    const char *ranges[] = {"MIN", "MAX", "AVG", "SUM", "STDEV"};
-    // start with this or not :
-    int i;
-    for (i = 0; i < 5; i++)
+static void lazy_push_dirty(uint32_t id, void *ctx)
+{
+    RecalcWalk *walk = (RecalcWalk *)ctx;
+    Spreadsheet *sheet = walk->sheet;
+    if (lazy_is_dirty(sheet, id))
+        return;
+    sheet->dirty[id >> 6] |= (uint64_t)1 << (id & 63);
+    recalc_reserve(sheet, walk->size);
+    sheet->stack[walk->size++] = id;
+}
+
+static void lazy_mark_dirty(Spreadsheet *sheet, uint32_t id)
+{
+    RecalcWalk walk = {sheet, 0, 0};
+    lazy_push_dirty(id, &walk);
+    while (walk.size > 0)
     {
-        if (strncmp(formula, ranges[i], strlen(ranges[i])) == 0)
+        uint32_t marked = sheet->stack[--walk.size];
+        spreadsheet_dep_foreach(sheet, recalc_cell(sheet, marked), lazy_push_dirty, &walk);
+    }
+}
+
+/* Queues a dirty cell for evaluation and walks on to its dirty precedents */
+static void lazy_collect(RecalcWalk *walk, int *pending, uint32_t id)
+{
+    Spreadsheet *sheet = walk->sheet;
+    if (!lazy_is_dirty(sheet, id) || !recalc_mark(sheet, id))
+        return;
+    recalc_reserve(sheet, walk->size);
+    queue_push(sheet->queue, &walk->size, (uint64_t)sheet->ranks[id] << 32 | id);
+    recalc_reserve(sheet, *pending);
+    sheet->stack[(*pending)++] = id;
+}
+
+/* Visits the dirty cells of a rectangle, skipping clean bitmap words whole */
+static void lazy_collect_range(RecalcWalk *walk, int *pending, int r1, int r2, int c1, int c2)
+{
+    Spreadsheet *sheet = walk->sheet;
+    int length;
+    int runs = range_runs(sheet, r1, r2, c1, c2, &length);
+    int first = spreadsheet_cell_id(sheet, r1, c1);
+    for (int i = 0; i < runs; i++, first += sheet->cols)
+    {
+        int last = first + length - 1;
+        for (int b = first; b <= last;)
         {
-            // fprintf(stderr, "%s\n", ranges[i]);
-            char *brack_sign = strchr(formula, '(');
-            const char *new_formula = brack_sign + 1;
-            int temp = strlen(new_formula);
-            // printf("%s",new_formula);
-            char only_range[100];
-            strncpy(only_range, new_formula, temp - 1);
-            only_range[temp - 1] = '\0';
-            // printf("%s", only_range);
-
-            int col1, row1, col2, row2;
-            char col_start[10], col_end[10];
-
-            // Parse range format like "A1:B3"
-            if (sscanf(only_range, "%[A-Z]%d:%[A-Z]%d", col_start, &row1, col_end, &row2) == 4)
+            uint64_t word = sheet->dirty[b >> 6] >> (b & 63);
+            if (word == 0)
             {
-                col1 = col_to_index(col_start);
-                col2 = col_to_index(col_end);
-                row1--; // Convert to 0-based index
-                row2--;
-
-                if (col2 < col1)
-                {
-                    // fprintf(stderr, "Invalid formula format.\n");
-                    return -1;
-                }
-                else if (col1 == col2 && row2 < row1)
-                {
-                    // fprintf(stderr, "Invalid formula format.\n");
-                    return -1;
-                }
-
-                clock_t start = clock();
-                // fprintf(stderr, "range inside update depend..func %d %d \n %d %d\n", row1, col1, row2, col2);
-                for (int r = row1; r <= row2; r++)
-                {
-                    for (int c = col1; c <= col2; c++)
-                    {
-                        
-                        Cell *dep_cell = sheet->cells[sheet->cols * (r) + (c)];
-                        if (!dep_cell)
-                        {
-                            
-                            fprintf(stderr, "cell not found\n");
-                        }
-                        // fprintf(stderr, "%d %d %s\n", dep_cell->row, dep_cell->col, cell_name);
-                        cell_dep_insert(dep_cell, cell_name);
-
-                        // orderedset_insert(new_depends, result);
-                    }
-                    // printf("\n");
-                }
-                clock_t end = clock();
-                double time_taken = (double)(end - start) / CLOCKS_PER_SEC;
-                // printf("Time taken by loop in extract_visible_cell: %f\n", time_taken);
+                b = (b | 63) + 1;
+                continue;
             }
-            break;
+            b += __builtin_ctzll(word);
+            if (b > last)
+                break;
+            lazy_collect(walk, pending, b);
+            b++;
         }
     }
-    // it is not of the range form then :
-    if (i >= 5)
-    {
+}
 
-        int r1, r2, c1, c2, range_bool;
-        find_depends(formula, sheet, &r1, &r2, &c1, &c2, &range_bool);
-        
-        if (r1 > 0)
+/* Brings every cell of the rectangle up to date. Dirty cells in it and their dirty
+   precedents are gathered first, then evaluated in rank order so each reads only
+   finished values. Does nothing outside lazy mode, where no cell is ever dirty */
+void spreadsheet_resolve_range(Spreadsheet *sheet, int r1, int r2, int c1, int c2)
+{
+    if (sheet->dirty == NULL)
+        return;
+    recalc_next_epoch(sheet);
+    RecalcWalk walk = {sheet, 0, 0};
+    int pending = 0;
+    lazy_collect_range(&walk, &pending, r1, r2, c1, c2);
+    while (pending > 0)
+    {
+        Formula resolved;
+        spreadsheet_cell_formula(sheet, recalc_cell(sheet, sheet->stack[--pending]), &resolved);
+        const Formula *formula = &resolved;
+        if (formula_is_range(formula))
         {
-            Cell *dep_cell = sheet->cells[sheet->cols * (r1 - 1) + (c1 - 1)];
-            cell_dep_insert(dep_cell, cell_name);
+            lazy_collect_range(&walk, &pending, formula->r1, formula->r2, formula->c1, formula->c2);
+            continue;
         }
-        if (r2 > 0)
+        if (formula->lhs.id != FORMULA_NO_CELL)
+            lazy_collect(&walk, &pending, formula->lhs.id);
+        if (formula->rhs.id != FORMULA_NO_CELL)
+            lazy_collect(&walk, &pending, formula->rhs.id);
+    }
+    while (walk.size > 0)
+    {
+        uint32_t id = (uint32_t)queue_pop(sheet->queue, &walk.size);
+        Cell *target = spreadsheet_get_cell_by_id(sheet, id);
+        char error = spreadsheet_get_error(sheet, target->row, target->col);
+        int x = spreadsheet_evaluate_cell(sheet, target, &error);
+        spreadsheet_store_value(sheet, target->row, target->col, x, error);
+        sheet->dirty[id >> 6] &= ~((uint64_t)1 << (id & 63));
+        sheet->stats.evaluated++;
+    }
+}
+
+void spreadsheet_resolve(Spreadsheet *sheet, int row, int col)
+{
+    spreadsheet_resolve_range(sheet, row, row, col, col);
+}
+
+/* Switches lazy mode on or off. Leaving it resolves every dirty cell first */
+void spreadsheet_set_lazy(Spreadsheet *sheet, int lazy)
+{
+    if (lazy && sheet->dirty == NULL)
+    {
+        // Edits waiting for a manual recalculation are settled before cells turn dirty
+        spreadsheet_recalc_pending(sheet);
+        sheet->dirty = (uint64_t *)calloc(((size_t)sheet->rows * sheet->cols + 63) / 64, sizeof(uint64_t));
+        if (sheet->dirty == NULL)
         {
-            Cell *dep_cell = sheet->cells[sheet->cols * (r2 - 1) + (c2 - 1)];
-            cell_dep_insert(dep_cell, cell_name);
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
         }
+    }
+    else if (!lazy && sheet->dirty != NULL)
+    {
+        spreadsheet_resolve_range(sheet, 1, sheet->rows, 1, sheet->cols);
+        free(sheet->dirty);
+        sheet->dirty = NULL;
+    }
+}
 
+/* ----------------
+   Cycle Detection
+   ---------------- */
+
+/* Pushes a dependent that is still ranked low enough to lead to a precedent */
+static void cycle_push(uint32_t id, void *ctx)
+{
+    RecalcWalk *walk = (RecalcWalk *)ctx;
+    Spreadsheet *sheet = walk->sheet;
+    if (sheet->ranks[id] > walk->bound || !recalc_mark(sheet, id))
+        return;
+    recalc_reserve(sheet, walk->size);
+    sheet->stack[walk->size++] = id;
+}
+
+/* This is the very function called after validation of any cell. Checks whether a cell
+   that the new formula of cell reads also reads cell, directly or transitively. bound is
+   the highest rank among those cells, nothing ranked above it can lead back to them */
+
+int first_step_find_cycle(Spreadsheet *sheet, Cell *cell, int r1, int r2, int c1, int c2, int range_bool, int bound)
+{
+    uint32_t start = spreadsheet_cell_id(sheet, cell->row, cell->col);
+    // Every precedent ranks below the cell, so none of them can read it
+    if (bound < sheet->ranks[start])
+        return 0;
+
+    recalc_next_epoch(sheet);
+    RecalcWalk walk = {sheet, 0, bound};
+    recalc_reserve(sheet, 0);
+    recalc_mark(sheet, start);
+    sheet->stack[walk.size++] = start;
+    while (walk.size > 0)
+    {
+        uint32_t id = sheet->stack[--walk.size];
+        int row = id / sheet->cols + 1;
+        int col = id % sheet->cols + 1;
+        if ((range_bool == 1 && (row >= r1 && row <= r2 && col >= c1 && col <= c2)) || (range_bool == 0 && ((row == r1 && col == c1) || (row == r2 && col == c2))))
+            return 1;
+        spreadsheet_dep_foreach(sheet, recalc_cell(sheet, id), cycle_push, &walk);
     }
     return 0;
+}
+
+/* Swaps the template of a cell for the shape of formula, interned relative to the cell */
+static void assign_shape(Spreadsheet *sheet, Cell *cell, const Formula *formula)
+{
+    Formula shape;
+    formula_relative(formula, cell->row, cell->col, sheet->cols, &shape);
+    uint32_t id = templatetable_intern(sheet->templates, &shape);
+    templatetable_release(sheet->templates, cell->shape);
+    cell->shape = id;
+}
+
+/* Keeps the template of an accepted formula, and builds its aggregate */
+static void assign_store_formula(Spreadsheet *sheet, Cell *cell, const Formula *formula)
+{
+    assign_shape(sheet, cell, formula);
+    // Range formulas keep a running aggregate, built once here and updated by every store into the range
+    if (formula_is_range(formula))
+    {
+        if (cell->aggregate == NULL)
+            cell->aggregate = (RangeAggregate *)slab_alloc(&sheet->aggregate_pool);
+        if (sheet->minmax == NULL && (formula->op == FORMULA_MIN || formula->op == FORMULA_MAX))
+            sheet->minmax = minmaxtree_create(sheet->values, sheet->rows, sheet->cols);
+        aggregate_build(sheet, formula, cell->aggregate);
+    }
+    else
+    {
+        slab_free(&sheet->aggregate_pool, cell->aggregate);
+        cell->aggregate = NULL;
+    }
+}
+
+/* Assigns an already parsed formula to the cell at (row, col) and recalculates */
+
+void spreadsheet_assign_formula(Spreadsheet *sheet, int row, int col, const Formula *formula, char *status_out,
+                                size_t status_size)
+{
+    Cell *cell = spreadsheet_get_cell(sheet, row, col);
+
+    int r1, r2, c1, c2;
+    int range_bool;
+    find_depends(formula, sheet, &r1, &r2, &c1, &c2, &range_bool);
+    int bound = spreadsheet_precedent_rank(sheet, r1, r2, c1, c2, range_bool);
+    if (first_step_find_cycle(sheet, cell, r1, r2, c1, c2, range_bool, bound))
+    {
+        // printf("Cycle Detected\n");
+        safe_strcpy(status_out, status_size, "Cycle Detected");
+        return;
+    }
+    v_spreadsheet_update_dependencies(sheet, cell, formula);
+    rank_raise(sheet, spreadsheet_cell_id(sheet, row, col), bound);
+    assign_store_formula(sheet, cell, formula);
+    freeze_if_stale(sheet);
+    if (sheet->dirty != NULL)
+        lazy_mark_dirty(sheet, spreadsheet_cell_id(sheet, row, col));
+    else if (sheet->manual)
+        manual_defer(sheet, spreadsheet_cell_id(sheet, row, col));
+    else
+        spreadsheet_recalc(sheet, cell);
+    safe_strcpy(status_out, status_size, "ok");
+}
+
+/* ----------------
+   Bulk Assignment
+   ---------------- */
+
+/* A bulk load puts every new formula into the graph first and finds all cycles with one
+   strongly connected component pass over the cells downstream of them, instead of a
+   search per formula. Only new formulas on a cycle are taken back. Putting back their
+   old formulas can close a cycle through other new formulas, so the pass repeats until
+   one finds nothing; that last pass also yields the topological order ranks are set in */
+
+typedef struct TarjanFrame
+{
+    uint32_t id;
+    int next;       // next successor of id to visit in the edge buffer
+    int end;
+    int self_loop;  // id reads itself
+} TarjanFrame;
 
+typedef struct Tarjan
+{
+    Spreadsheet *sheet;
+    int32_t *index;     // visit number per cell id, -1 once the cell's component is done
+    int32_t *low;       // lowest visit number reachable, -1 marks a cell on a cycle
+    int counter;        // cells visited in this pass
+    uint32_t *edges;    // successors of the cells on the frame stack
+    int edge_count;
+    int edge_capacity;
+    TarjanFrame *frames;
+    int frame_count;
+    int frame_capacity;
+    int scc_count;      // cells on the sheet's stack, visited and not yet assigned to a component
+    int done_count;     // cells in the sheet's order buffer, in the order their components finished
+} Tarjan;
+
+static void *bulk_grow(void *buffer, int *capacity, size_t size)
+{
+    *capacity = *capacity ? *capacity * 2 : 64;
+    buffer = realloc(buffer, *capacity * size);
+    if (buffer == NULL)
+    {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    return buffer;
+}
+
+static void tarjan_push_edge(uint32_t id, void *ctx)
+{
+    Tarjan *tarjan = (Tarjan *)ctx;
+    if (tarjan->edge_count == tarjan->edge_capacity)
+        tarjan->edges = (uint32_t *)bulk_grow(tarjan->edges, &tarjan->edge_capacity, sizeof(uint32_t));
+    tarjan->edges[tarjan->edge_count++] = id;
 }
 
-/* Topo sort used in recalculations */
+static void tarjan_enter(Tarjan *tarjan, uint32_t id)
+{
+    Spreadsheet *sheet = tarjan->sheet;
+    // Both the component stack and the finished list hold at most the cells visited so far
+    recalc_reserve(sheet, tarjan->counter);
+    recalc_mark(sheet, id);
+    tarjan->index[id] = tarjan->low[id] = tarjan->counter++;
+    sheet->stack[tarjan->scc_count++] = id;
+    if (tarjan->frame_count == tarjan->frame_capacity)
+        tarjan->frames = (TarjanFrame *)bulk_grow(tarjan->frames, &tarjan->frame_capacity, sizeof(TarjanFrame));
+    TarjanFrame *frame = &tarjan->frames[tarjan->frame_count++];
+    frame->id = id;
+    frame->next = tarjan->edge_count;
+    frame->self_loop = 0;
+    spreadsheet_dep_foreach(sheet, recalc_cell(sheet, id), tarjan_push_edge, tarjan);
+    frame->end = tarjan->edge_count;
+}
 
-Node_l *topo_sort(Spreadsheet *sheet, Cell *starting)
+/* Iterative Tarjan from one cell along dependent edges. Cells of a component with more
+   than one cell, or reading themselves, get low -1 */
+static void tarjan_visit(Tarjan *tarjan, uint32_t root)
 {
-    // fprintf(stderr,"@ %d %d\n",starting->row,starting->col);
-    Node_l *head = NULL;
-    Node *st_top = createNode(starting);
-    OrderedSet *visited = orderedset_create();
-    char temp_col[10];
-    index_to_col((starting->col) - 1, temp_col);
-    char temp_row[10];
-    sprintf(temp_row, "%d", starting->row);
-    
-    while (!isEmpty(st_top))
+    Spreadsheet *sheet = tarjan->sheet;
+    tarjan_enter(tarjan, root);
+    while (tarjan->frame_count > 0)
     {
-        Cell *now = peek(st_top);
-        char **keys = NULL;
-        int size = 0;
-        if (now->container == 0)
+        TarjanFrame *frame = &tarjan->frames[tarjan->frame_count - 1];
+        uint32_t id = frame->id;
+        if (frame->next < frame->end)
         {
-            vector_collect_keys(now->dependents.dependents_vector, &keys, &size);
+            uint32_t next = tarjan->edges[frame->next++];
+            if (next == id)
+                frame->self_loop = 1;
+            else if (sheet->marks[next] != sheet->epoch)
+                tarjan_enter(tarjan, next);
+            else if (tarjan->index[next] >= 0 && tarjan->index[next] < tarjan->low[id])
+                tarjan->low[id] = tarjan->index[next];
+            continue;
         }
-        else
+        // The finished cell's successors were pushed right after its parent's
+        int self_loop = frame->self_loop;
+        tarjan->edge_count = tarjan->frame_count > 1 ? tarjan->frames[tarjan->frame_count - 2].end : 0;
+        tarjan->frame_count--;
+        if (tarjan->frame_count > 0)
         {
-            v_orderedset_collect_keys(now->dependents.dependents_set, &keys, &size);
+            uint32_t parent = tarjan->frames[tarjan->frame_count - 1].id;
+            if (tarjan->low[id] < tarjan->low[parent])
+                tarjan->low[parent] = tarjan->low[id];
         }
-        // int flag = 1;
-        for (int i = 0; i < (size); i++)
+        if (tarjan->low[id] != tarjan->index[id])
+            continue;
+        // id is the root of a component, it and everything above it on the stack form it
+        int first = tarjan->scc_count - 1;
+        while (sheet->stack[first] != id)
+            first--;
+        int cyclic = self_loop || first < tarjan->scc_count - 1;
+        for (int i = first; i < tarjan->scc_count; i++)
         {
-            char *ref = keys[i];
-            
-            int r_, c_;
-            spreadsheet_parse_cell_name(sheet, ref, &r_, &c_);
-            Cell *dep_cell = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-            if (!dep_cell)
-            {
-                
-                fprintf(stderr, "cell not found\n");
-            }
-            if (!orderedset_contains(visited, ref))
-            {
-                push(&st_top, dep_cell);
-                // orderedset_insert(visited,ref);
-            }
+            uint32_t member = sheet->stack[i];
+            tarjan->index[member] = -1;
+            tarjan->low[member] = cyclic ? -1 : 0;
+            sheet->order[tarjan->done_count++] = member;
+        }
+        tarjan->scc_count = first;
+    }
+}
+
+/* Puts a formula's reads into the graph, an empty formula reads nothing. The cell takes
+   over the caller's hold on the template, the one it had is left to the caller */
+static void bulk_link(Spreadsheet *sheet, Cell *cell, uint32_t shape)
+{
+    Formula formula;
+    formula_anchor(templatetable_shape(sheet->templates, shape), cell->row, cell->col, sheet->cols, &formula);
+    if (formula.op == FORMULA_NONE)
+        remove_old_dependents(sheet, cell);
+    else
+        v_spreadsheet_update_dependencies(sheet, cell, &formula);
+    cell->shape = shape;
+}
+
+/* Raises ranks over the cells of the last pass in topological order, each new formula
+   above what it reads and every cell above the cells it reads */
+static void bulk_rank_push(uint32_t id, void *ctx)
+{
+    RecalcWalk *walk = (RecalcWalk *)ctx;
+    if (walk->sheet->ranks[id] <= walk->bound)
+        rank_set(walk->sheet, id, walk->bound + 1);
+}
+
+/* Assigns a batch of parsed formulas at once and recalculates what they change in one
+   pass. A formula is rejected with "Cycle Detected" when it lies on a cycle of the
+   batch as a whole, not only with the formulas before it. Only the last assignment to
+   a cell takes part, earlier ones are superseded */
+void spreadsheet_assign_bulk(Spreadsheet *sheet, BulkAssignment *items, int count)
+{
+    int *live = (int *)malloc((count + 1) * sizeof(int));
+    uint32_t *old = (uint32_t *)malloc((count + 1) * sizeof(uint32_t));
+    char *rejected = (char *)calloc(count + 1, 1);
+    uint32_t *ids = (uint32_t *)malloc((count + 1) * sizeof(uint32_t));
+    size_t cell_count = (size_t)sheet->rows * sheet->cols;
+    Tarjan tarjan = {0};
+    tarjan.sheet = sheet;
+    tarjan.index = (int32_t *)malloc(cell_count * sizeof(int32_t));
+    tarjan.low = (int32_t *)malloc(cell_count * sizeof(int32_t));
+    if (live == NULL || old == NULL || rejected == NULL || ids == NULL || tarjan.index == NULL || tarjan.low == NULL)
+    {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+
+    recalc_next_epoch(sheet);
+    int lives = 0;
+    for (int i = count - 1; i >= 0; i--)
+    {
+        safe_strcpy(items[i].status, sizeof(items[i].status), "ok");
+        if (recalc_mark(sheet, spreadsheet_cell_id(sheet, items[i].row, items[i].col)))
+            live[lives++] = i;
+    }
+    for (int k = 0; k < lives; k++)
+    {
+        BulkAssignment *item = &items[live[k]];
+        Cell *cell = spreadsheet_get_cell(sheet, item->row, item->col);
+        ids[k] = spreadsheet_cell_id(sheet, item->row, item->col);
+        Formula shape;
+        formula_relative(&item->formula, item->row, item->col, sheet->cols, &shape);
+        old[k] = cell->shape;
+        bulk_link(sheet, cell, templatetable_intern(sheet->templates, &shape));
+    }
+
+    for (;;)
+    {
+        recalc_next_epoch(sheet);
+        tarjan.counter = tarjan.done_count = 0;
+        for (int k = 0; k < lives; k++)
+        {
+            if (!rejected[k] && sheet->marks[ids[k]] != sheet->epoch)
+                tarjan_visit(&tarjan, ids[k]);
         }
-        if (now == peek(st_top))
+        int taken_back = 0;
+        for (int k = 0; k < lives; k++)
         {
-            pop(&st_top);
-            insertFront(&head, now);
-            char cell_name[64];
-            spreadsheet_get_cell_name(now->row, now->col, cell_name, sizeof(cell_name));
-            orderedset_insert(visited, cell_name);
+            if (rejected[k] || tarjan.low[ids[k]] != -1)
+                continue;
+            rejected[k] = 1;
+            taken_back++;
+            Cell *cell = spreadsheet_get_cell_by_id(sheet, ids[k]);
+            uint32_t shape = cell->shape;
+            bulk_link(sheet, cell, old[k]);
+            templatetable_release(sheet->templates, shape);
+            safe_strcpy(items[live[k]].status, sizeof(items[live[k]].status), "Cycle Detected");
         }
-        // }
-        for (int x = 0; x < size; x++)
-            free(keys[x]);
-        if (keys)
-            free(keys);
+        if (taken_back == 0)
+            break;
+    }
+
+    // Components finished sinks first, so the reverse is a topological order. The last
+    // pass found no cycle, low is free to flag the new formulas that stay
+    for (int k = 0; k < lives; k++)
+        tarjan.low[ids[k]] = rejected[k] ? 0 : 1;
+    for (int i = tarjan.done_count - 1; i >= 0; i--)
+    {
+        uint32_t id = sheet->order[i];
+        const Cell *cell = recalc_cell(sheet, id);
+        if (tarjan.low[id] == 1)
+        {
+            int r1, r2, c1, c2, range_bool;
+            Formula formula;
+            spreadsheet_cell_formula(sheet, cell, &formula);
+            find_depends(&formula, sheet, &r1, &r2, &c1, &c2, &range_bool);
+            int bound = spreadsheet_precedent_rank(sheet, r1, r2, c1, c2, range_bool);
+            if (sheet->ranks[id] <= bound)
+                rank_set(sheet, id, bound + 1);
+        }
+        RecalcWalk walk = {sheet, 0, sheet->ranks[id]};
+        spreadsheet_dep_foreach(sheet, cell, bulk_rank_push, &walk);
+    }
+
+    int accepted = 0;
+    for (int k = 0; k < lives; k++)
+    {
+        if (rejected[k])
+            continue;
+        // The cell already holds the new template, only the aggregate is still to build
+        assign_store_formula(sheet, spreadsheet_get_cell_by_id(sheet, ids[k]), &items[live[k]].formula);
+        templatetable_release(sheet->templates, old[k]);
+        ids[accepted++] = ids[k];
+    }
+    freeze_if_stale(sheet);
+    if (sheet->dirty != NULL)
+    {
+        for (int k = 0; k < accepted; k++)
+            lazy_mark_dirty(sheet, ids[k]);
+    }
+    else if (sheet->manual)
+    {
+        for (int k = 0; k < accepted; k++)
+            manual_defer(sheet, ids[k]);
+    }
+    else
+    {
+        recalc_from(sheet, ids, accepted);
     }
 
-    destroyStack(&st_top);
-    orderedset_destroy(visited);
-    return head;
+    free(live);
+    free(old);
+    free(rejected);
+    free(ids);
+    free(tarjan.index);
+    free(tarjan.low);
+    free(tarjan.edges);
+    free(tarjan.frames);
 }
 
-/* This is the primary function called by main.c whenever some command is input */
+/* This is the primary function called whenever some command is input as text */
 
 void spreadsheet_set_cell_value(Spreadsheet *sheet, char *cell_name, const char *formula,
                                 char *status_out, size_t status_size)
@@ -1137,59 +1866,16 @@ void spreadsheet_set_cell_value(Spreadsheet *sheet, char *cell_name, const char
         safe_strcpy(status_out, status_size, "invalid args");
         return;
     }
-   
-    int r_, c_;
-    spreadsheet_parse_cell_name(sheet, cell_name, &r_, &c_);
-    Cell *cell = sheet->cells[sheet->cols * (r_ - 1) + (c_ - 1)];
-    
-    char *cpy_formula = malloc(strlen(formula) + 1);
-    strcpy(cpy_formula, formula);
-    clock_t start_time = clock();
-    int r1, r2, c1, c2;
-    int range_bool;
-    if (find_depends(cpy_formula, sheet, &r1, &r2, &c1, &c2, &range_bool) == -1)
+
+    // The command is parsed once here, everything below works on the parse result
+    int row, col;
+    Formula parsed;
+    if (!spreadsheet_parse_command(sheet, cell_name, formula, &row, &col, &parsed))
     {
-        free(cpy_formula);
         safe_strcpy(status_out, status_size, "invalid command");
         return;
     }
-    clock_t end_time = clock();
-    double elapsed_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    
-    start_time = clock();
-    if (first_step_find_cycle(sheet, cell_name, r1, r2, c1, c2, range_bool))
-    {
-        // printf("Cycle Detected\n");
-        free(cpy_formula);
-        safe_strcpy(status_out, status_size, "Cycle Detected");
-        return;
-    }
-    end_time = clock();
-    elapsed_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    // printf("Time taken by first_step_find_cycle: %.6f seconds\n", elapsed_time);
-    // fprintf(stderr, "[DEBUG]6\n");
-    start_time = clock();
-    v_spreadsheet_update_dependencies(sheet, cell_name, cpy_formula);
-    end_time = clock();
-    elapsed_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    
-    free(cell->formula);
-    cell->formula = strdup(formula);
-    // fprintf(stderr, "hereeee\n");
-    Node_l *head = topo_sort(sheet, cell);
-    
-    Node_l *curr = head;
-    while (curr != NULL)
-    {
-        // fprintf(stderr, "cell row %d cell col %d\n", curr->data->row, curr->data->col);
-        int x = spreadsheet_evaluate_expression(sheet, curr->data->formula, curr->data);
-        curr->data->value = x;
-        // fprintf(stderr, "%d\n\n\n", x);
-        curr = curr->next;
-    }
-    free(cpy_formula);
-    freeList(&head);
-    safe_strcpy(status_out, status_size, "ok");
+    spreadsheet_assign_formula(sheet, row, col, &parsed, status_out, status_size);
 }
 /* ----------------
    Display
@@ -1202,6 +1888,7 @@ void spreadsheet_display(Spreadsheet *sheet)
     // fprintf(stderr, "[DEBUG] Displaying spreadsheet\n");
     int end_row = (sheet->view_row + 10 < sheet->rows) ? (sheet->view_row + 10) : sheet->rows;
     int end_col = (sheet->view_col + 10 < sheet->cols) ? (sheet->view_col + 10) : sheet->cols;
+    spreadsheet_resolve_range(sheet, sheet->view_row + 1, end_row, sheet->view_col + 1, end_col);
 
     // Print col headers
     printf("\t\t");
@@ -1222,256 +1909,47 @@ void spreadsheet_display(Spreadsheet *sheet)
             char cell_name[64];
             spreadsheet_get_cell_name(row, col, cell_name, sizeof(cell_name));
             // Cell *cell = ordereddict_get(sheet->cells, cell_name);
-            Cell *cell = sheet->cells[sheet->cols * (row - 1) + (col - 1)];
-            if (cell)
+            if (spreadsheet_get_error(sheet, row, col))
             {
-                if (cell->error)
-                {
-                    printf("ERR\t\t");
-                }
-                else
-                {
-                    printf("%-16d", cell->value);
-                }
+                printf("ERR\t\t");
             }
             else
             {
-                printf("0\t\t");
+                printf("%-16d", spreadsheet_get_value(sheet, row, col));
             }
         }
         printf("\n");
     }
 }
 
-/* Checks all kinds of validity of commands so that intermediate checks in each function not required */
+/* Parses the target cell and the formula of a command in a single pass. Returns 1 and
+   fills row, col and out if the command is valid */
 
-int is_valid_command(Spreadsheet *sheet, char **cell_name, char **formula)
+int spreadsheet_parse_command(const Spreadsheet *sheet, const char *cell_name, const char *formula,
+                              int *row, int *col, Formula *out)
 {
-    if (!sheet || !cell_name || !formula || !*cell_name || !*formula || **cell_name == '\0' || **formula == '\0')
+    if (!sheet || !cell_name || !formula || *cell_name == '\0' || *formula == '\0')
     {
         return 0;
     }
     // Check if valid cell name
-    int r, c;
-    if (!spreadsheet_parse_cell_name(sheet, *cell_name, &r, &c))
+    if (!spreadsheet_parse_cell_name(sheet, cell_name, row, col))
     {
         return 0;
     }
     // Check if valid formula
-    if (!*formula || strlen(*formula) == 0)
-        return 0;
-    
-    regex_t funcRegex;
-    regcomp(&funcRegex, "^([A-Za-z]+)\\((.*)\\)$", REG_EXTENDED);
-    regmatch_t matches[3];
-    if (regexec(&funcRegex, *formula, 3, matches, 0) == 0)
-    {
-        char func[64], args0[256];
-        char *args = args0;
-        strncpy(func, *formula + matches[1].rm_so, matches[1].rm_eo - matches[1].rm_so);
-        func[matches[1].rm_eo - matches[1].rm_so] = '\0';
-        strncpy(args, *formula + matches[2].rm_so, matches[2].rm_eo - matches[2].rm_so);
-        args[matches[2].rm_eo - matches[2].rm_so] = '\0';
-        regfree(&funcRegex);
-        if (strcasecmp(func, "SLEEP") == 0)
-        {
-            if (args[0] == '\0')
-            {
-                return 0;
-            }
-            // Check if args is a valid integer
-            char *endPtr = NULL;
-            long val = strtol(args, &endPtr, 10);
-            if (endPtr && *endPtr == '\0')
-            {
-                return 1;
-            }
-            if (args[0] == '-' || args[0] == '+')
-            {
-                args++;
-            }
-            int r;
-            int c;
-            if (spreadsheet_parse_cell_name(sheet, args, &r, &c))
-            {
-                return 1;
-            }
-            return 0;
-        }
-        else
-        {
-
-            char *copy = strdup(args);
-            char *colon = strchr(copy, ':');
-            if (!colon)
-            {
-                free(copy);
-                return 0;
-            }
-            *colon = '\0';
-            const char *start = copy;
-            const char *end = colon + 1;
+    return formula_parse(formula, sheet->rows, sheet->cols, out);
+}
 
-            int start_row, start_col, end_row, end_col;
-            if (!spreadsheet_parse_cell_name(sheet, start, &start_row, &start_col))
-            {
-                free(copy);
-                return 0;
-            }
-            if (!spreadsheet_parse_cell_name(sheet, end, &end_row, &end_col))
-            {
-                free(copy);
-                return 0;
-            }
-            if (start_row > end_row || start_col > end_col)
-            {
-                free(copy);
-                return 0;
-            }
-            if (strcasecmp(func, "MIN") != 0 && strcasecmp(func, "MAX") != 0 && strcasecmp(func, "SUM") != 0 && strcasecmp(func, "AVG") != 0 && strcasecmp(func, "STDEV") != 0)
-            {
-                free(copy);
-                return 0;
-            }
-            free(copy);
-        }
-        return 1;
-    }
-    regfree(&funcRegex);
-    // Check if the expr is a cell reference (e.g. A1)
-    regex_t cellRegex;
-    regcomp(&cellRegex, "^[A-Za-z]+[0-9]+$", REG_EXTENDED);
-    if (regexec(&cellRegex, *formula, 0, NULL, 0) == 0)
-    {
-        // It's a cell reference
-        regfree(&cellRegex);
-        int r, c;
-        if (spreadsheet_parse_cell_name(sheet, *formula, &r, &c))
-        {
-            return 1;
-        }
-        return 0;
-    }
-    regfree(&cellRegex);
+/* Checks all kinds of validity of commands so that intermediate checks in each function not required */
 
-    char *expr = *formula;
-    int temp = strlen(expr);
-    int i = 0;
-    char flag = 0;
-    if (expr[i] == '+' || expr[i] == '-')
-    {
-        i++;
-        flag = 1;
-    }
-    if (expr[i] >= 48 && expr[i] <= 57)
-    {
-        int j = i;
-        while (j < temp && isdigit(expr[j]))
-        {
-            j++;
-        }
-        i = j;
-        // fprintf(stderr, "1 is an int\n");
-    }
-    else if (flag == 0 && expr[i] >= 65 && expr[i] <= 90)
-    {
-        int j = i;
-        while (j < temp && expr[j] >= 65 && expr[j] <= 90)
-        {
-            j++;
-        }
-        int k = j;
-        int row = 0;
-        while (k < temp && isdigit(expr[k]))
-        {
-            row = row * 10 + expr[k] - '0';
-            k++;
-        }
-        int temp_l = k - i;
-        char cell_name_[10];
-        strncpy(cell_name_, expr + i, temp_l);
-        cell_name_[temp_l] = '\0';
-        int r, c;
-        if (!spreadsheet_parse_cell_name(sheet, cell_name_, &r, &c))
-        {
-            return 0;
-        }
-        i = k;
-    }
-    else
-    {
-        return 0;
-    }
-    // fprintf(stderr, "i = %d, temp = %d", i, temp);
-    char operation;
-    if (i < temp)
-    {
-        // fprintf(stderr, "I came here\n");
-        operation = expr[i];
-        if (operation != '+' && operation != '-' && operation != '*' && operation != '/')
-        {
-            return 0;
-        }
-    }
-    else
-    {
-        // fprintf(stderr, "valid command A1=1\n");
-        return 1;
-    }
-    i++;
-    // fprintf(stderr, "%d", i);
-    flag = 0;
-    if (expr[i] == '+' || expr[i] == '-')
-    {
-        i++;
-        flag = 1;
-    }
-    if (expr[i] >= 48 && expr[i] <= 57)
-    {
-        int j = i;
-        while (j < temp && isdigit(expr[j]))
-        {
-            j++;
-        }
-        i = j;
-    }
-    else if (flag == 0 && expr[i] >= 65 && expr[i] <= 90)
-    {
-        int j = i;
-        while (j < temp && expr[j] >= 65 && expr[j] <= 90)
-        {
-            j++;
-        }
-        int k = j;
-        int row = 0;
-        while (k < temp && isdigit(expr[k]))
-        {
-            row = row * 10 + expr[k] - '0';
-            k++;
-        }
-        int temp_l = k - i;
-        char cell_name_[10];
-        strncpy(cell_name_, expr + i, temp_l);
-        cell_name_[temp_l] = '\0';
-        int r, c;
-        if (!spreadsheet_parse_cell_name(sheet, cell_name_, &r, &c))
-        {
-            return 0;
-        }
-        i = k;
-    }
-    else
-    {
-        return 0;
-    }
-    if (i == temp)
-    {
-        return 1;
-    }
-    else
+int is_valid_command(Spreadsheet *sheet, char **cell_name, char **formula)
+{
+    if (!cell_name || !formula)
     {
         return 0;
     }
-
-    return 0;
+    int r, c;
+    Formula parsed;
+    return spreadsheet_parse_command(sheet, *cell_name, *formula, &r, &c, &parsed);
 }
@@ -2,48 +2,145 @@
 #define SPREADSHEET_H
 
 #include <stddef.h>
-#include "stack.h"
-#include "linked_list.h"
+#include "cell.h"
+#include "rangeindex.h"
+#include "prefixsum.h"
+#include "minmaxtree.h"
+#include "threadpool.h"
+#include "csrgraph.h"
+#include "slab.h"
 
+// Cells are stored in lazily allocated pages of SHEET_PAGE_ROWS x SHEET_PAGE_COLS
+#define SHEET_PAGE_ROWS 32
+#define SHEET_PAGE_COLS 32
+
+// Value and error of a cell evaluated ahead of its store
+typedef struct RecalcResult {
+    int32_t value;
+    char error;
+} RecalcResult;
+
+// Running totals of recalculation work
+typedef struct RecalcStats {
+    uint64_t evaluated; // cells evaluated
+    uint64_t unchanged; // evaluated cells whose value and error flag stayed the same
+    uint64_t skipped;   // dependents of unchanged cells never queued, they were not evaluated
+} RecalcStats;
+
+// One assignment of a bulk load, status is filled in by spreadsheet_assign_bulk
+typedef struct BulkAssignment {
+    int row;
+    int col;
+    Formula formula;
+    char status[32];
+} BulkAssignment;
+
+// Cell ids are row-major: id = (row - 1) * cols + (col - 1)
 typedef struct Spreadsheet {
     int rows;
     int cols;
-    Cell **cells;
+    int32_t *values;    // value of every cell, indexed by cell id
+    uint64_t *errors;   // error flag of every cell, one bit per cell id
+    int page_rows;
+    int page_cols;
+    Cell ***pages;      // formula/dependency records, only for cells that need one
+    SlabPool cell_pool; // every Cell of the pages
+    SlabPool aggregate_pool; // RangeAggregates of range formulas
+    TemplateTable *templates; // formula shapes shared by the cells, a cell holds only its template id
+    RangeIndex *ranges; // rectangles read by range formulas, keyed by the formula's cell
+    PrefixSum *prefix;  // optional 2D prefix sums of values, NULL unless enabled
+    MinMaxTree *minmax; // tiled MIN/MAX summaries, built with the first MIN/MAX formula
+    uint32_t *marks;    // epoch stamp per cell id, set when a graph walk reaches the cell
+    uint32_t epoch;     // stamp of the current walk, bumping it clears every mark
+    int32_t *ranks;     // per cell id, a formula ranks above every cell it reads
+    MinMaxTree *rank_tree; // max rank over rectangles, built with the first range formula
+    uint32_t *stack;    // DFS stack of the cycle check and of rank raising, component stack of a bulk load
+    uint32_t *order;    // recalculation order produced by the last walk, finish order of a bulk load
+    uint64_t *queue;    // rank-keyed heap the recalculation order is drained from
+    RecalcResult *results; // evaluated but not yet stored cells of a parallel level
+    int walk_capacity;  // length of stack, order, queue and results
+    ThreadPool *pool;   // NULL unless recalculation runs on several threads
+    RecalcStats stats;
+    uint64_t *dirty;    // lazy mode: one bit per cell id whose value is out of date, NULL otherwise
+    int manual;         // assignments wait in pending until spreadsheet_recalc_pending
+    uint32_t *pending;  // cells assigned since the last recalculation in manual mode
+    int pending_count;
+    int pending_capacity;
+    CsrGraph *frozen;       // CSR snapshot of the spilled dependent sets, NULL until the first freeze
+    uint32_t graph_edits;   // point dependency edits since the last freeze
     int view_row;
     int view_col;
 } Spreadsheet;
 
+static inline int spreadsheet_cell_id(const Spreadsheet *sheet, int row, int col)
+{
+    return (row - 1) * sheet->cols + (col - 1);
+}
+
+static inline int spreadsheet_get_value(const Spreadsheet *sheet, int row, int col)
+{
+    return sheet->values[spreadsheet_cell_id(sheet, row, col)];
+}
+
+static inline char spreadsheet_get_error(const Spreadsheet *sheet, int row, int col)
+{
+    int id = spreadsheet_cell_id(sheet, row, col);
+    return (sheet->errors[id >> 6] >> (id & 63)) & 1;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 void safe_strcpy(char *dest, size_t dest_size, const char *src);
 Spreadsheet *spreadsheet_create(int rows, int cols);
 void destroySpreadsheet (Spreadsheet*sheet);
+int spreadsheet_enable_prefix_sums(Spreadsheet *sheet);
+void spreadsheet_set_threads(Spreadsheet *sheet, int threads);
+Cell *spreadsheet_get_cell(Spreadsheet *sheet, int row, int col);
+Cell *spreadsheet_get_cell_by_id(Spreadsheet *sheet, uint32_t id);
+Cell *spreadsheet_find_cell(const Spreadsheet *sheet, int row, int col);
+const Cell *spreadsheet_peek_cell(const Spreadsheet *sheet, int row, int col);
+void spreadsheet_store_value(Spreadsheet *sheet, int row, int col, int value, char error);
+int spreadsheet_range_has_error(const Spreadsheet *sheet, int r1, int r2, int c1, int c2);
+int spreadsheet_range_error_count(const Spreadsheet *sheet, int r1, int r2, int c1, int c2);
 
 char* spreadsheet_col_to_letter(int col, char *buffer, size_t size);
 int spreadsheet_letter_to_col(const char *letters);
 int col_to_index(const char *col);
 void index_to_col(int index, char *col);
-int find_depends(const char *formula, Spreadsheet *sheet, int *r1, int *r2, int *c1, int *c2, int *range_bool);
+int find_depends(const Formula *formula, const Spreadsheet *sheet, int *r1, int *r2, int *c1, int *c2, int *range_bool);
 
 char* spreadsheet_get_cell_name( int row, int col, char *buffer, size_t size);
 int spreadsheet_parse_cell_name(const Spreadsheet *sheet, const char *cell_name, int *out_row, int *out_col);
 int isNumeric(const char *str);
 
-int spreadsheet_evaluate_function(Spreadsheet *sheet, const char *func, const char *args, Cell* cell,const char*expr);
-int spreadsheet_evaluate_expression(Spreadsheet *sheet, const char *expr, Cell* cell);
-void v_inorder_traversal_helper(OrderedSetNode *node, char **array, int *index);
-int count_nodes(OrderedSetNode *node);
-void vector_collect_keys(Vector* vec, char ***array, int *size);
-void v_orderedset_collect_keys(OrderedSet *set, char ***array, int *size);
-int rec_find_cycle_using_stack(Spreadsheet*sheet, int r1,int r2 ,int c1,int c2,int range_bool, OrderedSet *visited, Node **top);
-int first_step_find_cycle(Spreadsheet *sheet, char *cell_name, int r1,int r2 ,int c1,int c2,int range_bool);
-void remove_old_dependents(Spreadsheet *sheet, const char *cell_name);
-int v_spreadsheet_update_dependencies(Spreadsheet *sheet, const char *cell_name, const char *formula);
-Node_l* topo_sort(Spreadsheet *sheet, Cell * starting);
+int spreadsheet_evaluate_function(Spreadsheet *sheet, const Formula *formula, char *error);
+int spreadsheet_run_formula(Spreadsheet *sheet, const Formula *formula, char *error);
+void spreadsheet_cell_formula(const Spreadsheet *sheet, const Cell *cell, Formula *out);
+int spreadsheet_formula_text(const Spreadsheet *sheet, int row, int col, char *buf, size_t size);
+int spreadsheet_evaluate_cell(Spreadsheet *sheet, Cell *cell, char *error);
+int spreadsheet_evaluate_expression(Spreadsheet *sheet, const char *expr, char *error);
+void spreadsheet_dep_foreach(const Spreadsheet *sheet, const Cell *cell, void (*func)(uint32_t, void *), void *ctx);
+void spreadsheet_freeze_dependents(Spreadsheet *sheet);
+void spreadsheet_thaw_dependents(Spreadsheet *sheet);
+void spreadsheet_prec_foreach(const Spreadsheet *sheet, const Cell *cell, void (*func)(uint32_t, void *), void *ctx);
+int spreadsheet_precedent_rank(Spreadsheet *sheet, int r1, int r2, int c1, int c2, int range_bool);
+int first_step_find_cycle(Spreadsheet *sheet, Cell *cell, int r1,int r2 ,int c1,int c2,int range_bool, int bound);
+void remove_old_dependents(Spreadsheet *sheet, Cell *cell);
+int v_spreadsheet_update_dependencies(Spreadsheet *sheet, Cell *cell, const Formula *formula);
+int spreadsheet_recalc_order(Spreadsheet *sheet, const Cell *starting, const uint32_t **order);
+void spreadsheet_recalc(Spreadsheet *sheet, const Cell *starting);
+void spreadsheet_set_manual(Spreadsheet *sheet, int manual);
+void spreadsheet_recalc_pending(Spreadsheet *sheet);
+void spreadsheet_set_lazy(Spreadsheet *sheet, int lazy);
+void spreadsheet_resolve(Spreadsheet *sheet, int row, int col);
+void spreadsheet_resolve_range(Spreadsheet *sheet, int r1, int r2, int c1, int c2);
+void spreadsheet_assign_formula(Spreadsheet *sheet, int row, int col, const Formula *formula, char *status_out, size_t status_size);
+void spreadsheet_assign_bulk(Spreadsheet *sheet, BulkAssignment *items, int count);
 void spreadsheet_set_cell_value(Spreadsheet *sheet, char *cell_name, const char *formula, char *status_out, size_t status_size);
 void spreadsheet_display(Spreadsheet *sheet);
 
+int spreadsheet_parse_command(const Spreadsheet *sheet, const char *cell_name, const char *formula, int *row, int *col, Formula *out);
 int is_valid_command(Spreadsheet *sheet, char **cell_name, char **formula);
 #ifdef __cplusplus
 }
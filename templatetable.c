@@ -0,0 +1,136 @@
+// templatetable.c
+#include "templatetable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEMPLATE_MIN_SLOTS 64
+
+static void* checked_alloc(void *ptr) {
+    if (!ptr) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Field by field, the struct has padding after op
+static uint32_t shape_hash(const Formula *shape) {
+    uint64_t h = shape->op;
+    uint64_t parts[3] = {
+        (uint64_t)(uint32_t)shape->lhs.value << 32 | shape->lhs.id,
+        (uint64_t)(uint32_t)shape->rhs.value << 32 | shape->rhs.id,
+        (uint64_t)(uint16_t)shape->r1 << 48 | (uint64_t)(uint16_t)shape->r2 << 32 |
+            (uint32_t)(uint16_t)shape->c1 << 16 | (uint16_t)shape->c2
+    };
+    for (int i = 0; i < 3; i++) {
+        h = (h ^ parts[i]) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 29;
+    }
+    return (uint32_t)(h >> 32);
+}
+
+static int shape_equal(const Formula *a, const Formula *b) {
+    return a->op == b->op && a->lhs.value == b->lhs.value && a->lhs.id == b->lhs.id &&
+           a->rhs.value == b->rhs.value && a->rhs.id == b->rhs.id &&
+           a->r1 == b->r1 && a->r2 == b->r2 && a->c1 == b->c1 && a->c2 == b->c2;
+}
+
+static void slots_insert(uint32_t *slots, uint32_t slot_count, uint32_t hash, uint32_t id) {
+    uint32_t mask = slot_count - 1;
+    uint32_t i = hash & mask;
+    while (slots[i] != TEMPLATE_EMPTY)
+        i = (i + 1) & mask;
+    slots[i] = id;
+}
+
+static void slots_resize(TemplateTable *table, uint32_t slot_count) {
+    uint32_t *slots = checked_alloc(malloc(slot_count * sizeof(uint32_t)));
+    memset(slots, 0xff, slot_count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < table->slot_count; i++) {
+        uint32_t id = table->slots[i];
+        if (id != TEMPLATE_EMPTY)
+            slots_insert(slots, slot_count, table->templates[id].hash, id);
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+}
+
+TemplateTable* templatetable_create(void) {
+    TemplateTable *table = checked_alloc(calloc(1, sizeof(TemplateTable)));
+    table->capacity = 16;
+    table->templates = checked_alloc(calloc(table->capacity, sizeof(FormulaTemplate)));
+    // Id 0 is the empty formula, it is never in the hash table
+    table->templates[TEMPLATE_NONE].shape.lhs.id = FORMULA_NO_CELL;
+    table->templates[TEMPLATE_NONE].shape.rhs.id = FORMULA_NO_CELL;
+    table->count = 1;
+    table->free_list = TEMPLATE_NONE;
+    slots_resize(table, TEMPLATE_MIN_SLOTS);
+    return table;
+}
+
+uint32_t templatetable_intern(TemplateTable *table, const Formula *shape) {
+    if (shape->op == FORMULA_NONE)
+        return TEMPLATE_NONE;
+    uint32_t hash = shape_hash(shape);
+    uint32_t mask = table->slot_count - 1;
+    for (uint32_t i = hash & mask; table->slots[i] != TEMPLATE_EMPTY; i = (i + 1) & mask) {
+        FormulaTemplate *found = &table->templates[table->slots[i]];
+        if (found->hash == hash && shape_equal(&found->shape, shape)) {
+            found->refs++;
+            return table->slots[i];
+        }
+    }
+
+    uint32_t id = table->free_list;
+    if (id != TEMPLATE_NONE) {
+        table->free_list = table->templates[id].next_free;
+    } else {
+        if (table->count == table->capacity) {
+            table->capacity *= 2;
+            table->templates = checked_alloc(realloc(table->templates, table->capacity * sizeof(FormulaTemplate)));
+        }
+        id = table->count++;
+    }
+    FormulaTemplate *entry = &table->templates[id];
+    entry->shape = *shape;
+    entry->hash = hash;
+    entry->refs = 1;
+    slots_insert(table->slots, table->slot_count, hash, id);
+    if (++table->live * 2 > table->slot_count)
+        slots_resize(table, table->slot_count * 2);
+    return id;
+}
+
+void templatetable_release(TemplateTable *table, uint32_t id) {
+    if (id == TEMPLATE_NONE || --table->templates[id].refs > 0)
+        return;
+    // Backward shift deletion like DepSet, lookups never meet tombstones
+    uint32_t mask = table->slot_count - 1;
+    uint32_t i = table->templates[id].hash & mask;
+    while (table->slots[i] != id)
+        i = (i + 1) & mask;
+    table->slots[i] = TEMPLATE_EMPTY;
+    for (uint32_t j = (i + 1) & mask; table->slots[j] != TEMPLATE_EMPTY; j = (j + 1) & mask) {
+        uint32_t home = table->templates[table->slots[j]].hash & mask;
+        int stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays)
+            continue;
+        table->slots[i] = table->slots[j];
+        table->slots[j] = TEMPLATE_EMPTY;
+        i = j;
+    }
+    table->templates[id].next_free = table->free_list;
+    table->free_list = id;
+    table->live--;
+}
+
+void templatetable_destroy(TemplateTable *table) {
+    if (table == NULL)
+        return;
+    free(table->templates);
+    free(table->slots);
+    free(table);
+}
@@ -0,0 +1,45 @@
+// templatetable.h
+#ifndef TEMPLATETABLE_H
+#define TEMPLATETABLE_H
+
+#include <stdint.h>
+#include "formula.h"
+
+// Template id of the empty formula, never counted or freed
+#define TEMPLATE_NONE 0
+#define TEMPLATE_EMPTY UINT32_MAX
+
+// A formula shape shared by every cell holding it, references are relative (see
+// formula_relative) so B1=MAX(A1:A10) and B2=MAX(A2:A11) are one template
+typedef struct FormulaTemplate {
+    Formula shape;
+    uint32_t hash;
+    uint32_t refs;      // cells holding the template, 0 while the id is free
+    uint32_t next_free; // next free id while refs is 0
+} FormulaTemplate;
+
+// Interns formula shapes. Templates live in an array indexed by id, an open-addressing
+// hash table with linear probing maps a shape to its id. Ids are reference counted and
+// recycled once no cell holds them, so edits that keep changing constants do not grow it
+typedef struct TemplateTable {
+    FormulaTemplate *templates;
+    uint32_t count;         // ids handed out so far, free ones included
+    uint32_t capacity;      // length of templates
+    uint32_t free_list;     // first free id, TEMPLATE_NONE if there is none
+    uint32_t live;          // ids held by at least one cell
+    uint32_t *slots;        // ids by hash, TEMPLATE_EMPTY marks a free slot
+    uint32_t slot_count;
+} TemplateTable;
+
+TemplateTable* templatetable_create(void);
+// Returns the id of shape, counting one more holder
+uint32_t templatetable_intern(TemplateTable *table, const Formula *shape);
+// Counts one holder less, the id is recycled once nobody holds it
+void templatetable_release(TemplateTable *table, uint32_t id);
+void templatetable_destroy(TemplateTable *table);
+
+static inline const Formula* templatetable_shape(const TemplateTable *table, uint32_t id) {
+    return &table->templates[id].shape;
+}
+
+#endif // TEMPLATETABLE_H
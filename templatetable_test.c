@@ -0,0 +1,97 @@
+#include "templatetable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define COLS 100
+#define SHAPES 3000
+
+// A formula read at (row, col) as the shape a sheet with COLS columns would intern
+Formula shape_at(const char *expr, int row, int col) {
+    Formula formula, shape;
+    assert(formula_parse(expr, 1000, COLS, &formula));
+    formula_relative(&formula, row, col, COLS, &shape);
+    return shape;
+}
+
+int main() {
+    printf("=== TemplateTable Test Suite ===\n\n");
+
+    printf("Test 1: Filled down formulas share one template\n");
+    TemplateTable *table = templatetable_create();
+    Formula b1 = shape_at("MAX(A1:A10)", 1, 2);
+    Formula b2 = shape_at("MAX(A2:A11)", 2, 2);
+    Formula c9 = shape_at("B8+A9", 9, 3);
+    Formula d10 = shape_at("C9+B10", 10, 4);
+    uint32_t range = templatetable_intern(table, &b1);
+    assert(range != TEMPLATE_NONE);
+    assert(templatetable_intern(table, &b2) == range);
+    uint32_t sum = templatetable_intern(table, &c9);
+    assert(templatetable_intern(table, &d10) == sum && sum != range);
+    assert(table->live == 2 && table->templates[range].refs == 2);
+
+    // Resolving the shared shape at another cell gives that cell's formula
+    Formula resolved, expected;
+    formula_anchor(templatetable_shape(table, range), 5, 2, COLS, &resolved);
+    assert(formula_parse("MAX(A5:A14)", 1000, COLS, &expected));
+    assert(resolved.op == expected.op && resolved.r1 == expected.r1 && resolved.r2 == expected.r2);
+    assert(resolved.c1 == expected.c1 && resolved.c2 == expected.c2);
+    formula_anchor(templatetable_shape(table, sum), 2, 3, COLS, &resolved);
+    assert(resolved.lhs.id == 1 && resolved.rhs.id == COLS);
+    printf("Range and arithmetic shapes - PASS\n\n");
+
+    printf("Test 2: Constants, the empty formula and released ids\n");
+    Formula five = shape_at("5", 3, 3);
+    Formula six = shape_at("6", 3, 3);
+    uint32_t id5 = templatetable_intern(table, &five);
+    assert(templatetable_intern(table, &six) != id5);
+    Formula none = {0};
+    assert(templatetable_intern(table, &none) == TEMPLATE_NONE);
+    assert(templatetable_shape(table, TEMPLATE_NONE)->op == FORMULA_NONE);
+    templatetable_release(table, TEMPLATE_NONE);
+
+    // The last holder frees the id, the next new shape takes it over
+    templatetable_release(table, range);
+    assert(table->templates[range].refs == 1);
+    templatetable_release(table, range);
+    assert(table->live == 3);
+    Formula other = shape_at("MIN(A1:B2)", 1, 3);
+    assert(templatetable_intern(table, &other) == range);
+    assert(templatetable_intern(table, &b1) != range);
+    printf("Ids are recycled - PASS\n\n");
+
+    printf("Test 3: Many shapes against a reference\n");
+    templatetable_destroy(table);
+    table = templatetable_create();
+    static uint32_t ids[SHAPES];
+    static int refs[SHAPES];
+    srand(9);
+    for (int round = 0; round < 40000; round++) {
+        int k = rand() % SHAPES;
+        Formula shape = shape_at("A1*2", 1, 1);
+        shape.rhs.value = k;
+        if (refs[k] > 0 && rand() % 2 == 0) {
+            templatetable_release(table, ids[k]);
+            refs[k]--;
+        } else {
+            uint32_t id = templatetable_intern(table, &shape);
+            assert(refs[k] == 0 || id == ids[k]);
+            ids[k] = id;
+            refs[k]++;
+        }
+    }
+    uint32_t live = 0;
+    for (int k = 0; k < SHAPES; k++) {
+        if (refs[k] == 0)
+            continue;
+        live++;
+        assert(table->templates[ids[k]].refs == (uint32_t)refs[k]);
+        assert(templatetable_shape(table, ids[k])->rhs.value == k);
+    }
+    assert(table->live == live && table->count <= SHAPES + 1);
+    templatetable_destroy(table);
+    printf("%u live shapes - PASS\n\n", live);
+
+    printf("All templatetable tests passed!\n");
+    return 0;
+}
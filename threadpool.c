@@ -0,0 +1,174 @@
+// threadpool.c
+#include "threadpool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Chunks per worker when a loop is split, leaving room for stealing to even out the load
+#define CHUNKS_PER_WORKER 4
+
+static void deque_push(WorkDeque *deque, int chunk) {
+    if (deque->tail == deque->capacity) {
+        deque->capacity = deque->capacity ? deque->capacity * 2 : 16;
+        deque->chunks = realloc(deque->chunks, deque->capacity * sizeof(int));
+        if (!deque->chunks) {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
+        }
+    }
+    deque->chunks[deque->tail++] = chunk;
+}
+
+// Takes a chunk from the back (owner) or the front (thief), returns -1 if empty
+static int deque_take(WorkDeque *deque, int steal) {
+    int chunk = -1;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail)
+        chunk = steal ? deque->chunks[deque->head++] : deque->chunks[--deque->tail];
+    pthread_mutex_unlock(&deque->lock);
+    return chunk;
+}
+
+// Runs chunks until neither the own deque nor any other has one left
+static void work(ThreadPool *pool, int self) {
+    for (;;) {
+        int chunk = deque_take(&pool->deques[self], 0);
+        for (int i = 1; chunk < 0 && i < pool->threads; i++)
+            chunk = deque_take(&pool->deques[(self + i) % pool->threads], 1);
+        if (chunk < 0)
+            return;
+        int end = chunk + pool->chunk;
+        pool->task(chunk, end < pool->count ? end : pool->count, pool->ctx);
+    }
+}
+
+typedef struct WorkerArgs {
+    ThreadPool *pool;
+    int self;
+} WorkerArgs;
+
+static void *worker_main(void *arg) {
+    WorkerArgs args = *(WorkerArgs *)arg;
+    free(arg);
+    ThreadPool *pool = args.pool;
+    unsigned seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->shutdown)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->shutdown)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, args.self);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->idle++;
+        pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool* threadpool_create(int threads) {
+    if (threads < 1)
+        threads = 1;
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+    if (!pool) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    pool->threads = threads;
+    pool->workers = malloc(threads * sizeof(pthread_t));
+    pool->deques = calloc(threads, sizeof(WorkDeque));
+    if (!pool->workers || !pool->deques) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->generation = 0;
+    pool->idle = 0;
+    pool->shutdown = 0;
+
+    for (int i = 1; i < threads; i++) {
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        if (!args) {
+            perror("Failed to allocate memory");
+            exit(EXIT_FAILURE);
+        }
+        args->pool = pool;
+        args->self = i;
+        if (pthread_create(&pool->workers[i], NULL, worker_main, args) != 0) {
+            // Run with the threads that did start
+            free(args);
+            pool->threads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+// Runs task over [0, count) in chunks of at least min_chunk and returns once all of
+// them are done. Must not be called from inside a task.
+void threadpool_run(ThreadPool *pool, int count, int min_chunk, ThreadTask task, void *ctx) {
+    if (count <= 0)
+        return;
+    int chunk = count / (pool->threads * CHUNKS_PER_WORKER);
+    if (chunk < min_chunk)
+        chunk = min_chunk;
+    if (chunk < 1)
+        chunk = 1;
+    if (pool->threads == 1 || chunk >= count) {
+        task(0, count, ctx);
+        return;
+    }
+
+    // Deal the chunks out round-robin, the workers are all waiting so no locking is needed
+    for (int i = 0; i < pool->threads; i++)
+        pool->deques[i].head = pool->deques[i].tail = 0;
+    for (int begin = 0, i = 0; begin < count; begin += chunk, i++)
+        deque_push(&pool->deques[i % pool->threads], begin);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->chunk = chunk;
+    pool->idle = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->idle < pool->threads - 1)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_destroy(ThreadPool *pool) {
+    if (pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threads; i++)
+        pthread_join(pool->workers[i], NULL);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].chunks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
@@ -0,0 +1,42 @@
+// threadpool.h
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+// Runs task(begin, end, ctx) over chunks of [0, count)
+typedef void (*ThreadTask)(int begin, int end, void *ctx);
+
+// Chunks handed to one worker. The owner takes from the back, idle workers steal
+// from the front.
+typedef struct WorkDeque {
+    pthread_mutex_t lock;
+    int *chunks;            // start index of each chunk
+    int head;
+    int tail;
+    int capacity;
+} WorkDeque;
+
+// Fixed set of worker threads for parallel loops. The thread calling threadpool_run
+// works as worker 0, so a pool of n threads starts n - 1 of its own.
+typedef struct ThreadPool {
+    int threads;
+    pthread_t *workers;
+    WorkDeque *deques;      // one per worker, the caller's first
+    pthread_mutex_t lock;
+    pthread_cond_t start;   // a new loop was posted
+    pthread_cond_t done;    // a worker ran out of chunks
+    unsigned generation;    // loops posted so far
+    int idle;               // workers finished with the current loop
+    int shutdown;
+    ThreadTask task;
+    void *ctx;
+    int count;
+    int chunk;
+} ThreadPool;
+
+ThreadPool* threadpool_create(int threads);
+void threadpool_run(ThreadPool *pool, int count, int min_chunk, ThreadTask task, void *ctx);
+void threadpool_destroy(ThreadPool *pool);
+
+#endif // THREADPOOL_H
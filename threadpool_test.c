@@ -0,0 +1,76 @@
+#include "threadpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define COUNT 100000
+
+int hits[COUNT];
+
+// Counts every index it is handed, a slow stretch makes the other workers steal
+void count_task(int begin, int end, void *ctx) {
+    int *slow_below = (int *)ctx;
+    for (int i = begin; i < end; i++) {
+        hits[i]++;
+        if (i < *slow_below) {
+            volatile int spin = 0;
+            for (int k = 0; k < 2000; k++)
+                spin += k;
+        }
+    }
+}
+
+void check_once(int count) {
+    for (int i = 0; i < count; i++)
+        assert(hits[i] == 1);
+    for (int i = count; i < COUNT; i++)
+        assert(hits[i] == 0);
+}
+
+void clear_hits() {
+    for (int i = 0; i < COUNT; i++)
+        hits[i] = 0;
+}
+
+int main() {
+    printf("=== ThreadPool Test Suite ===\n\n");
+
+    printf("Test 1: Every index runs exactly once\n");
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        ThreadPool *pool = threadpool_create(threads);
+        assert(pool->threads == threads);
+        int slow_below = 0;
+        int counts[] = {1, 7, 100, 4097, COUNT};
+        for (int c = 0; c < 5; c++) {
+            clear_hits();
+            threadpool_run(pool, counts[c], 1, count_task, &slow_below);
+            check_once(counts[c]);
+        }
+        threadpool_destroy(pool);
+        printf("%d threads - PASS\n", threads);
+    }
+    printf("\n");
+
+    printf("Test 2: Uneven work is stolen and loops run back to back\n");
+    ThreadPool *pool = threadpool_create(4);
+    int slow_below = COUNT / 8;
+    for (int round = 0; round < 50; round++) {
+        clear_hits();
+        threadpool_run(pool, COUNT, 64, count_task, &slow_below);
+        check_once(COUNT);
+        slow_below = 0;
+    }
+    printf("50 loops - PASS\n\n");
+
+    printf("Test 3: Small loops stay on the caller\n");
+    clear_hits();
+    threadpool_run(pool, 10, 64, count_task, &slow_below);
+    check_once(10);
+    threadpool_run(pool, 0, 1, count_task, &slow_below);
+    check_once(10);
+    threadpool_destroy(pool);
+    printf("Below the minimum chunk - PASS\n\n");
+
+    printf("All threadpool tests passed!\n");
+    return 0;
+}
@@ -10,7 +10,7 @@
 void vector_init(Vector *vec) {
     vec->size = 0;
     vec->capacity = INITIAL_CAPACITY;
-    vec->data = (char **)malloc(vec->capacity * sizeof(char *));
+    vec->data = (uint32_t *)malloc(vec->capacity * sizeof(uint32_t));
     if (!vec->data) {
         perror("Failed to allocate memory");
         exit(EXIT_FAILURE);
@@ -21,48 +21,47 @@ void vector_init(Vector *vec) {
 // Function to resize the vector when full
 static void vector_resize(Vector *vec, size_t new_capacity) {
     vec->capacity = new_capacity;
-    vec->data = (char **)realloc(vec->data, vec->capacity * sizeof(char *));
+    vec->data = (uint32_t *)realloc(vec->data, vec->capacity * sizeof(uint32_t));
     if (!vec->data) {
         perror("Failed to reallocate memory");
         exit(EXIT_FAILURE);
     }
 }
 
-// Function to add a string to the end of the vector
-void vector_push_back(Vector *vec, const char *str) {
+// Function to add an id to the end of the vector
+void vector_push_back(Vector *vec, uint32_t id) {
     if (vec->size == vec->capacity) {
         vector_resize(vec, vec->capacity * 2);
     }
-    vec->data[vec->size] = strdup(str);
+    vec->data[vec->size] = id;
     vec->size++;
 }
 
-// Function to get a string at a specific index
-char *vector_get(Vector *vec, size_t index) {
+// Function to get the id at a specific index
+uint32_t vector_get(Vector *vec, size_t index) {
     if (index >= vec->size) {
         fprintf(stderr, "Index out of bounds\n");
-        return NULL;
+        return VECTOR_NPOS;
     }
     return vec->data[index];
 }
 
-// Function to set a string at a specific index
-void vector_set(Vector *vec, size_t index, const char *str) {
+// Function to set the id at a specific index
+void vector_set(Vector *vec, size_t index, uint32_t id) {
     if (index >= vec->size) {
         fprintf(stderr, "Index out of bounds\n");
         return;
     }
-    free(vec->data[index]); // Free existing memory
-    vec->data[index] = strdup(str);
+    vec->data[index] = id;
 }
 
-// Function to remove a string at a specific index
-void vector_remove(Vector *vec, const char *str) {
+// Function to remove an id from the vector
+void vector_remove(Vector *vec, uint32_t id) {
     size_t index = vec->size; // Set to an invalid index initially
 
-    // Find the index of the string to remove
+    // Find the index of the id to remove
     for (size_t i = 0; i < vec->size; i++) {
-        if (strcmp(vec->data[i], str) == 0) {
+        if (vec->data[i] == id) {
             index = i;
             break;
         }
@@ -70,12 +69,10 @@ void vector_remove(Vector *vec, const char *str) {
 
     // If not found, return
     if (index == vec->size) {
-        fprintf(stderr, "String not found in vector\n");
+        fprintf(stderr, "Id not found in vector\n");
         return;
     }
 
-    free(vec->data[index]); // Free the memory of the removed string
-
     // Shift remaining elements to the left
     for (size_t i = index; i < vec->size - 1; i++) {
         vec->data[i] = vec->data[i + 1];
@@ -97,9 +94,6 @@ size_t vector_size(Vector *vec) {
 
 // Function to free the memory allocated by the vector
 void vector_free(Vector *vec) {
-    for (size_t i = 0; i < vec->size; i++) {
-        free(vec->data[i]);
-    }
     free(vec->data);
     vec->size = 0;
     vec->capacity = 0;
@@ -4,19 +4,22 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Returned by vector_get for an out of range index
+#define VECTOR_NPOS UINT32_MAX
+
 // Define the vector structure
 typedef struct {
-    char **data;   // Array of char* strings
+    uint32_t *data;   // Array of cell ids
     int16_t size;   // Current number of elements
     int16_t capacity; // Maximum capacity before resizing
 } Vector;
 
 // Function prototypes
 void vector_init(Vector *vec);
-void vector_push_back(Vector *vec, const char *str);
-char *vector_get(Vector *vec, size_t index);
-void vector_set(Vector *vec, size_t index, const char *str);
-void vector_remove(Vector *vec, const char *str);
+void vector_push_back(Vector *vec, uint32_t id);
+uint32_t vector_get(Vector *vec, size_t index);
+void vector_set(Vector *vec, size_t index, uint32_t id);
+void vector_remove(Vector *vec, uint32_t id);
 void vector_free(Vector *vec);
 size_t vector_size(Vector *vec);
 
@@ -4,8 +4,8 @@
 #include <stdlib.h>
 #include <assert.h>
 
-void print_element(const char *str) {
-    printf("%s ", str);
+void print_element(uint32_t id) {
+    printf("%u ", id);
 }
 
 // Helper function to assert vector size
@@ -16,15 +16,14 @@ void assert_size(Vector *vec, size_t expected) {
 }
 
 // Helper function to assert vector element at index
-void assert_element(Vector *vec, size_t index, const char *expected) {
-    char *result = vector_get(vec, index);
-    int pass = (expected == NULL && result == NULL) || 
-               (result != NULL && expected != NULL && strcmp(result, expected) == 0);
+void assert_element(Vector *vec, size_t index, uint32_t expected) {
+    uint32_t result = vector_get(vec, index);
+    int pass = (result == expected);
     
-    printf("Element at %zu: %s (Expected: %s) - %s\n", 
+    printf("Element at %zu: %u (Expected: %u) - %s\n", 
            index, 
-           result ? result : "NULL", 
-           expected ? expected : "NULL", 
+           result, 
+           expected, 
            pass ? "PASS" : "FAIL");
     
     assert(pass);
@@ -40,33 +39,33 @@ int main() {
     printf("\n");
     
     printf("Test 2: Basic Insertion\n");
-    vector_push_back(&vec, "A1");
-    vector_push_back(&vec, "B1");
-    vector_push_back(&vec, "A5");
+    vector_push_back(&vec, 0);
+    vector_push_back(&vec, 1);
+    vector_push_back(&vec, 400);
     assert_size(&vec, 3);
-    assert_element(&vec, 0, "A1");
-    assert_element(&vec, 1, "B1");
-    assert_element(&vec, 2, "A5");
+    assert_element(&vec, 0, 0);
+    assert_element(&vec, 1, 1);
+    assert_element(&vec, 2, 400);
     printf("\n");
     
     printf("Test 3: Out-of-bounds Access\n");
-    assert_element(&vec, 3, NULL);
+    assert_element(&vec, 3, VECTOR_NPOS);
     printf("\n");
     
     printf("Test 4: Updating Elements\n");
-    vector_set(&vec, 1, "VVV879");
-    assert_element(&vec, 1, "VVV879");
+    vector_set(&vec, 1, 878);
+    assert_element(&vec, 1, 878);
     printf("\n");
     
     printf("Test 5: Removing Elements\n");
-    vector_remove(&vec, "A1");
+    vector_remove(&vec, 0);
     assert_size(&vec, 2);
-    assert_element(&vec, 0, "VVV879");
-    assert_element(&vec, 1, "A5");
+    assert_element(&vec, 0, 878);
+    assert_element(&vec, 1, 400);
     printf("\n");
     
     printf("Test 6: Removing Non-existent Element\n");
-    vector_remove(&vec, "X9");
+    vector_remove(&vec, 823);
     assert_size(&vec, 2);
     printf("\n");
     
@@ -77,9 +76,9 @@ int main() {
     
     printf("Test 8: Insert After Clear\n");
     vector_init(&vec);
-    vector_push_back(&vec, "Z26");
+    vector_push_back(&vec, 2525);
     assert_size(&vec, 1);
-    assert_element(&vec, 0, "Z26");
+    assert_element(&vec, 0, 2525);
     printf("\n");
     
     printf("All tests completed.\n");